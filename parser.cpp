@@ -1,422 +1,5408 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <array>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <climits>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <filesystem>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scanner.h"
+#include "scanner_dfa.h"
 
 using namespace std;
 
+const int EPSILON = -1;
+
+// Los simbolos se internan una sola vez al cargar la gramatica: los terminales
+// reciben los ids [0, num_terminales) y los no terminales los siguientes.
+struct TablaSimbolos {
+    vector<string> nombres;
+    unordered_map<string, int> ids;
+    int num_terminales = 0;
+
+    int agregar(const string& nombre) {
+        auto it = ids.find(nombre);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        int id = nombres.size();
+        nombres.push_back(nombre);
+        ids[nombre] = id;
+        return id;
+    }
+
+    int id(const string& nombre) const {
+        auto it = ids.find(nombre);
+        return it == ids.end() ? -1 : it->second;
+    }
+
+    const string& nombre(int id) const {
+        return nombres[id];
+    }
+
+    bool es_terminal(int id) const {
+        return id < num_terminales;
+    }
+
+    bool es_no_terminal(int id) const {
+        return id >= num_terminales;
+    }
+
+    int size() const {
+        return nombres.size();
+    }
+};
+
 struct produccion {
-    string left;
-    vector<string> right; 
+    int left;
+    vector<int> right;
 };
 
-struct Item {
-    int idx;
-    int dot_pos;
-    string lookahead;
+struct Gramatica {
+    TablaSimbolos simbolos;
+    vector<produccion> producciones;
+    vector<vector<int>> producciones_de;  // indices de producciones por no terminal
+    vector<int> orden_simbolos;           // simbolos de la gramatica y "$", ordenados por nombre
+    vector<int> orden_inicial;            // simbolos de goto_order presentes en la gramatica
+    int fin;
+};
 
-    bool operator<(const Item& o) const {
-        return tie(idx, dot_pos, lookahead) < tie(o.idx, o.dot_pos, o.lookahead);
+class ConjuntoTerminales {
+public:
+    ConjuntoTerminales(int num_terminales = 0) : palabras((num_terminales + 63) / 64, 0) {}
+
+    void insertar(int t) {
+        palabras[t >> 6] |= uint64_t(1) << (t & 63);
     }
-};
 
-set<string> first(const string& symbol, const vector<produccion>& producciones, const set<string>& noTerminales, map<string, set<string>>& memo) {
-    if (memo.count(symbol)) {
-        return memo[symbol];
+    bool contiene(int t) const {
+        return (palabras[t >> 6] >> (t & 63)) & 1;
     }
 
-    set<string> result;
+    bool unir(const ConjuntoTerminales& o) {
+        uint64_t nuevos = 0;
+        for (size_t i = 0; i < palabras.size(); ++i) {
+            nuevos |= o.palabras[i] & ~palabras[i];
+            palabras[i] |= o.palabras[i];
+        }
+        return nuevos != 0;
+    }
 
-    if(noTerminales.find(symbol) == noTerminales.end()) {
-        result.insert(symbol);
-        memo[symbol] = result;
-        return result;
+    int tamano() const {
+        int n = 0;
+        for (uint64_t w : palabras) n += __builtin_popcountll(w);
+        return n;
     }
 
-    for (const auto& prod : producciones) {
-        if (prod.left != symbol) {
-            continue;
-        }
+    bool operator==(const ConjuntoTerminales& o) const {
+        return palabras == o.palabras;
+    }
 
-        if (prod.right.empty()) {
-            result.insert("ε");
-            continue;
-        }
+    size_t hash() const {
+        size_t h = 0;
+        for (uint64_t w : palabras) h = (h ^ w) * 0x100000001b3ULL;
+        return h;
+    }
 
-        bool allNullable = true;
-        for (const auto& sym : prod.right) {
-            set<string> symFirst = first(sym, producciones, noTerminales, memo);
-            for(const auto& t : symFirst) {
-                if (t != "ε") {
-                    result.insert(t);
-                }
-            }
-            if (symFirst.find("ε") == symFirst.end()) {
-                allNullable = false;
-                break;
-            }
-        }
-        if (allNullable) {
-            result.insert("ε");
-        }   
+    bool operator<(const ConjuntoTerminales& o) const {
+        return palabras < o.palabras;
     }
-    memo[symbol] = result;
-    return result;
-}
 
-vector<string> beta(const vector<string>& right, int dot_pos, const string& lookahead) {
-    vector<string> beta_a;
-    for (int i = dot_pos + 1; i < right.size(); ++i) {
-        beta_a.push_back(right[i]);
+    // Acceso a las palabras de 64 bits, para leer y escribir conjuntos en binario.
+    size_t num_palabras() const {
+        return palabras.size();
+    }
+
+    uint64_t* datos() {
+        return palabras.data();
+    }
+
+    const uint64_t* datos() const {
+        return palabras.data();
     }
-    beta_a.push_back(lookahead);
-    return beta_a;
-}
 
-set<string> first_sequence(const vector<string>& seq, const vector<produccion>& producciones, const set<string>& noTerminales, map<string, set<string>>& memo) {
-    set<string> result;
-    bool allNullable = true;
-    
-    for (const auto& sym : seq) {
-        set<string> f = first(sym, producciones, noTerminales, memo);
-        for (const auto& s : f)
-            if (s != "ε") {
-                result.insert(s);
+    template <typename F>
+    void para_cada(F f) const {
+        for (size_t i = 0; i < palabras.size(); ++i) {
+            uint64_t w = palabras[i];
+            while (w) {
+                f(int(i * 64 + __builtin_ctzll(w)));
+                w &= w - 1;
             }
-        if (f.find("ε") == f.end()) {
-            allNullable = false;
-            break;
         }
     }
 
-    if (allNullable) {
-        result.insert("ε");
+private:
+    vector<uint64_t> palabras;
+};
+
+// Un item por nucleo (produccion, punto) con todos sus lookaheads en un conjunto de bits.
+// Un estado es un vector de items ordenado por nucleo.
+struct Item {
+    int idx;
+    int dot_pos;
+    ConjuntoTerminales lookahead;
+
+    bool mismo_nucleo(const Item& o) const {
+        return idx == o.idx && dot_pos == o.dot_pos;
+    }
+
+    bool operator<(const Item& o) const {
+        return tie(idx, dot_pos, lookahead) < tie(o.idx, o.dot_pos, o.lookahead);
+    }
+
+    bool operator==(const Item& o) const {
+        return idx == o.idx && dot_pos == o.dot_pos && lookahead == o.lookahead;
     }
-    return result;
+};
+
+typedef vector<Item> ConjuntoItems;
+
+bool menor_nucleo(const Item& a, const Item& b) {
+    return tie(a.idx, a.dot_pos) < tie(b.idx, b.dot_pos);
 }
 
-set<Item> closure(const set<Item>& I, const vector<produccion>& producciones, const set<string>& noTerminales, map<string, set<string>>& memo) {
-    set<Item> C = I;
-    bool changed = true;
+struct HashItems {
+    size_t operator()(const ConjuntoItems& items) const {
+        size_t h = 0xcbf29ce484222325ULL;
+        for (const auto& item : items) {
+            h = (h ^ (size_t(item.idx) << 16 ^ item.dot_pos)) * 0x100000001b3ULL;
+            h = (h ^ item.lookahead.hash()) * 0x100000001b3ULL;
+        }
+        return h;
+    }
+};
+
+// FIRST y anulables se calculan una sola vez por punto fijo. first_sufijo[p][i] es
+// FIRST(right[i..]) de la produccion p y sufijo_anulable[p][i] indica si ese sufijo deriva ε.
+struct AnalisisGramatica {
+    vector<char> anulable;
+    vector<ConjuntoTerminales> first;
+    vector<vector<ConjuntoTerminales>> first_sufijo;
+    vector<vector<char>> sufijo_anulable;
+};
 
+void punto_fijo_first(AnalisisGramatica& g, const vector<produccion>& producciones) {
+    bool changed = true;
     while (changed) {
         changed = false;
-        set<Item> to_add;
-        
-        for (const auto& item : C) {
-            const produccion& prod = producciones[item.idx];
-            if (item.dot_pos < prod.right.size()) {
-                string B = prod.right[item.dot_pos];
-                if (noTerminales.count(B)) {
-                    vector<string> beta_a = beta(prod.right, item.dot_pos, item.lookahead);
-                    set<string> lookaheads = first_sequence(beta_a, producciones, noTerminales, memo);
-                    for (int j = 0; j < producciones.size(); ++j) {
-                        if (producciones[j].left == B) {
-                            for (const auto& b : lookaheads) {
-                                Item new_item{j, 0, b};
-                                if (C.find(new_item) == C.end() && to_add.find(new_item) == to_add.end()) {
-                                    to_add.insert(new_item);
-                                    changed = true;
-                                }
-                            }
-                        }
-                    }
+        for (const auto& prod : producciones) {
+            bool allNullable = true;
+            for (int sym : prod.right) {
+                if (sym != prod.left && g.first[prod.left].unir(g.first[sym])) {
+                    changed = true;
                 }
+                if (!g.anulable[sym]) {
+                    allNullable = false;
+                    break;
+                }
+            }
+            if (allNullable && !g.anulable[prod.left]) {
+                g.anulable[prod.left] = 1;
+                changed = true;
             }
         }
-        
-        C.insert(to_add.begin(), to_add.end());
     }
-    return C;
 }
 
-set<Item> goto_fn(const set<Item>& I, const string& X, const vector<produccion>& producciones, const set<string>& noTerminales, map<string, set<string>>& memo) {
-    if (X == "ε") {
-        return {};
+void calcular_sufijos(AnalisisGramatica& g, const vector<produccion>& producciones, int T) {
+    g.first_sufijo.resize(producciones.size());
+    g.sufijo_anulable.resize(producciones.size());
+    for (size_t p = 0; p < producciones.size(); ++p) {
+        const auto& right = producciones[p].right;
+        g.first_sufijo[p].assign(right.size() + 1, ConjuntoTerminales(T));
+        g.sufijo_anulable[p].assign(right.size() + 1, 1);
+        for (int i = int(right.size()) - 1; i >= 0; --i) {
+            g.first_sufijo[p][i] = g.first[right[i]];
+            g.sufijo_anulable[p][i] = g.anulable[right[i]] && g.sufijo_anulable[p][i + 1];
+            if (g.anulable[right[i]]) {
+                g.first_sufijo[p][i].unir(g.first_sufijo[p][i + 1]);
+            }
+        }
     }
+}
 
-    set<Item> J;
-    for (const auto& item : I) {
-        const produccion& prod = producciones[item.idx];
-        if (prod.right.empty()) { 
-            continue;
-        }
-        if (item.dot_pos < prod.right.size() && prod.right[item.dot_pos] == X) {
-            Item moved_item{item.idx, item.dot_pos + 1, item.lookahead};
-            J.insert(moved_item);
-        }
+AnalisisGramatica analizar_gramatica(const vector<produccion>& producciones, const TablaSimbolos& simbolos) {
+    AnalisisGramatica g;
+    int T = simbolos.num_terminales;
+    g.anulable.assign(simbolos.size(), 0);
+    g.first.assign(simbolos.size(), ConjuntoTerminales(T));
+    for (int t = 0; t < T; ++t) {
+        g.first[t].insertar(t);
     }
-    return closure(J, producciones, noTerminales, memo);
+
+    punto_fijo_first(g, producciones);
+    calcular_sufijos(g, producciones, T);
+    return g;
 }
 
-bool parse_string(const vector<string>& input, const vector<produccion>& producciones, const map<int, map<string, string>>& action, const map<int, map<string, int>>& goto_table) {
-    vector<int> state_stack;
-    vector<string> symbol_stack;
+uint64_t reloj_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    state_stack.push_back(0);   
-    symbol_stack.push_back("$");
+// Contadores de la construccion para --stats; no se actualizan si activas es false. El
+// tiempo de cierre se suma por llamada (con --hilos, entre todos los hilos) y el de goto
+// es el resto de la construccion del automata: calcular los nucleos sucesores y
+// buscarlos en el mapa de nucleos, que hace de memo de estados.
+struct EstadisticasConstruccion {
+    bool activas = false;
+    atomic<uint64_t> llamadas_cierre{0}, items_cierre{0}, ns_cierre{0};
+    atomic<uint64_t> llamadas_goto{0}, items_goto{0}, ns_goto{0};
+    atomic<uint64_t> busquedas_nucleo{0}, nucleos_repetidos{0};
+    atomic<uint64_t> consultas_celda{0}, celdas_calculadas{0};
+    vector<pair<string, double>> fases;  // (nombre, ms de pared) en orden de ejecucion
 
-    size_t pos = 0;
-    string word = (pos < input.size()) ? input[pos] : "$";
+    template <typename F>
+    void medir_fase(const string& nombre, F f) {
+        uint64_t inicio = reloj_ns();
+        f();
+        if (activas) {
+            fases.push_back({nombre, (reloj_ns() - inicio) / 1e6});
+        }
+    }
 
-    while (true) {
-        int state = state_stack.back();
+    void registrar_cierre(uint64_t inicio, size_t items) {
+        if (activas) {
+            llamadas_cierre.fetch_add(1, memory_order_relaxed);
+            items_cierre.fetch_add(items, memory_order_relaxed);
+            ns_cierre.fetch_add(reloj_ns() - inicio, memory_order_relaxed);
+        }
+    }
 
-        auto it = action.find(state);
-        if (it == action.end() || it->second.find(word) == it->second.end()) {
-            cout << "Cadena rechazada (no hay acción para estado " << state << " y símbolo '" << word << "')." << endl;
-            return false;
+    void registrar_goto(size_t items) {
+        if (activas) {
+            llamadas_goto.fetch_add(1, memory_order_relaxed);
+            items_goto.fetch_add(items, memory_order_relaxed);
         }
+    }
 
-        string act = it->second.at(word);
+    // Suma a ns_goto el tiempo desde inicio que no se paso en cierres.
+    void registrar_tiempo_goto(uint64_t inicio, uint64_t ns_cierre_inicial) {
+        if (activas) {
+            ns_goto.fetch_add(reloj_ns() - inicio - (ns_cierre - ns_cierre_inicial), memory_order_relaxed);
+        }
+    }
 
-        if (act[0] == 'r') {
-            int prod_idx = stoi(act.substr(1));
-            const produccion& prod = producciones[prod_idx];
-            int rhs_size = prod.right.size();
+    void registrar_busqueda(bool repetido) {
+        if (activas) {
+            busquedas_nucleo.fetch_add(1, memory_order_relaxed);
+            nucleos_repetidos.fetch_add(repetido, memory_order_relaxed);
+        }
+    }
 
-            if (state_stack.size() < rhs_size || symbol_stack.size() < rhs_size) {
-                cout << "Error: pila demasiado pequeña para reducir (estado/símbolo)." << endl;
-                return false;
-            }
-            for (int i = 0; i < rhs_size; ++i) {
-                symbol_stack.pop_back();
-                state_stack.pop_back();
-            }
+    void registrar_celda(bool calculada) {
+        if (activas) {
+            consultas_celda.fetch_add(1, memory_order_relaxed);
+            celdas_calculadas.fetch_add(calculada, memory_order_relaxed);
+        }
+    }
+};
 
-            if (state_stack.empty()) {
-                cout << "Error: pila de estados vacía después de reducir." << endl;
-                return false;
-            }
-            int top_state = state_stack.back();
-            symbol_stack.push_back(prod.left);
+EstadisticasConstruccion estadisticas;
 
-            if (goto_table.find(top_state) == goto_table.end() ||
-                goto_table.at(top_state).find(prod.left) == goto_table.at(top_state).end()) {
-                cout << "Cadena rechazada (no hay goto para estado " << top_state << " y símbolo '" << prod.left << "')." << endl;
-                return false;
-            }
-            int next_state = goto_table.at(top_state).at(prod.left);
-            state_stack.push_back(next_state);
+ConjuntoItems closure(const ConjuntoItems& I, const Gramatica& g, const AnalisisGramatica& analisis) {
+    uint64_t inicio = estadisticas.activas ? reloj_ns() : 0;
+    // Los items agregados por el cierre tienen siempre el punto al inicio, asi que basta
+    // un indice por produccion para encontrar su nucleo dentro de C.
+    static thread_local vector<int> posicion;
+    posicion.resize(g.producciones.size(), -1);
+
+    ConjuntoItems C = I;
+    vector<int> pendientes;
+    vector<char> en_cola(C.size(), 1);
+    for (int i = 0; i < C.size(); ++i) {
+        if (C[i].dot_pos == 0) {
+            posicion[C[i].idx] = i;
         }
-        else if (act[0] == 's') { 
-            int next_state = stoi(act.substr(1));
-            symbol_stack.push_back(word);
-            state_stack.push_back(next_state);
+        pendientes.push_back(i);
+    }
 
-            ++pos;
-            word = (pos < input.size()) ? input[pos] : "$";
+    ConjuntoTerminales lookaheads;
+    while (!pendientes.empty()) {
+        int i = pendientes.back();
+        pendientes.pop_back();
+        en_cola[i] = 0;
+
+        const produccion& prod = g.producciones[C[i].idx];
+        int dot_pos = C[i].dot_pos;
+        if (dot_pos >= prod.right.size()) {
+            continue;
         }
-        else if (act == "acc") {
-            cout << "Cadena aceptada." << endl;
-            return true;
+        int B = prod.right[dot_pos];
+        if (!g.simbolos.es_no_terminal(B)) {
+            continue;
         }
-        else {
-            cout << "Cadena rechazada (acción inválida: " << act << ")." << endl;
-            return false;
+        lookaheads = analisis.first_sufijo[C[i].idx][dot_pos + 1];
+        if (analisis.sufijo_anulable[C[i].idx][dot_pos + 1]) {
+            lookaheads.unir(C[i].lookahead);
+        }
+        for (int j : g.producciones_de[B]) {
+            int k = posicion[j];
+            if (k < 0) {
+                posicion[j] = C.size();
+                C.push_back({j, 0, lookaheads});
+                en_cola.push_back(1);
+                pendientes.push_back(C.size() - 1);
+            } else if (C[k].lookahead.unir(lookaheads) && !en_cola[k]) {
+                en_cola[k] = 1;
+                pendientes.push_back(k);
+            }
+        }
+    }
+
+    for (const auto& item : C) {
+        if (item.dot_pos == 0) {
+            posicion[item.idx] = -1;
         }
     }
+    sort(C.begin(), C.end(), menor_nucleo);
+    estadisticas.registrar_cierre(inicio, C.size());
+    return C;
 }
 
-int main() {
-    vector<produccion> producciones;
+// Nucleo de goto(I, X): los items de I con X despues del punto, ya avanzados.
+ConjuntoItems nucleo_goto(const ConjuntoItems& I, int X, const Gramatica& g) {
+    ConjuntoItems J;
+    if (X == EPSILON) {
+        return J;
+    }
+    for (const auto& item : I) {
+        const produccion& prod = g.producciones[item.idx];
+        if (item.dot_pos < prod.right.size() && prod.right[item.dot_pos] == X) {
+            J.push_back({item.idx, item.dot_pos + 1, item.lookahead});
+        }
+    }
+    estadisticas.registrar_goto(J.size());
+    return J;
+}
 
-    ifstream infile("gramatica.txt");
-    if (!infile.is_open()) {
-        cerr << "Error al abrir el archivo de gramatica." << endl;
-        return 1;
+ConjuntoItems goto_fn(const ConjuntoItems& I, int X, const Gramatica& g, const AnalisisGramatica& analisis) {
+    ConjuntoItems J = nucleo_goto(I, X, g);
+    if (J.empty()) {
+        return J;
     }
+    return closure(J, g, analisis);
+}
 
-    string line;
-    while(getline(infile, line)) {
-        if (line.empty()) {
-            continue;
-        }
+struct Estado {
+    ConjuntoItems nucleo;
+    ConjuntoItems items;
+    vector<pair<int, int>> transiciones;  // (simbolo, estado destino)
+};
 
-        size_t flecha = line.find("->");
+struct Automata {
+    vector<Estado> estados;
+};
 
-        if (flecha == string::npos) {
-            cerr << "Error: la linea no contiene '->': " << line << endl;
+// Cierre LR(0): solo nucleos, con conjuntos de lookahead vacios.
+ConjuntoItems closure_lr0(const ConjuntoItems& I, const Gramatica& g) {
+    uint64_t inicio = estadisticas.activas ? reloj_ns() : 0;
+    static thread_local vector<char> presente;
+    presente.resize(g.producciones.size(), 0);
+
+    ConjuntoItems C = I;
+    ConjuntoTerminales vacio(g.simbolos.num_terminales);
+    for (const auto& item : C) {
+        if (item.dot_pos == 0) {
+            presente[item.idx] = 1;
+        }
+    }
+    for (size_t i = 0; i < C.size(); ++i) {
+        const produccion& prod = g.producciones[C[i].idx];
+        if (C[i].dot_pos >= prod.right.size() || !g.simbolos.es_no_terminal(prod.right[C[i].dot_pos])) {
             continue;
         }
+        for (int j : g.producciones_de[prod.right[C[i].dot_pos]]) {
+            if (!presente[j]) {
+                presente[j] = 1;
+                C.push_back({j, 0, vacio});
+            }
+        }
+    }
 
-        string left = line.substr(0, flecha);
-        string right_side = line.substr(flecha + 2);
+    for (const auto& item : C) {
+        if (item.dot_pos == 0) {
+            presente[item.idx] = 0;
+        }
+    }
+    sort(C.begin(), C.end(), menor_nucleo);
+    estadisticas.registrar_cierre(inicio, C.size());
+    return C;
+}
 
-        left.erase(0, left.find_first_not_of(" \t"));
-        left.erase(left.find_last_not_of(" \t") + 1);
+// Los estados se identifican por su nucleo: el cierre solo se calcula cuando goto
+// produce un nucleo que todavia no existe.
+template <typename Cierre>
+Automata construir_automata(const Gramatica& g, const ConjuntoTerminales& lookahead_inicial, Cierre cerrar) {
+    uint64_t inicio = estadisticas.activas ? reloj_ns() : 0;
+    uint64_t ns_cierre_inicial = estadisticas.ns_cierre;
+    Automata automata;
+    vector<Estado>& estados = automata.estados;
+    unordered_map<ConjuntoItems, int, HashItems> estado_id;
 
-        vector<string> right;
-        stringstream ss(right_side);
-        string simbolo;
+    auto obtener_estado = [&](ConjuntoItems& nucleo) {
+        auto it = estado_id.find(nucleo);
+        estadisticas.registrar_busqueda(it != estado_id.end());
+        if (it != estado_id.end()) {
+            return it->second;
+        }
+        int nuevo_id = estados.size();
+        estados.push_back({nucleo, cerrar(nucleo), {}});
+        estado_id.emplace(move(nucleo), nuevo_id);
+        return nuevo_id;
+    };
 
-        while (ss >> simbolo) {
-            right.push_back(simbolo);
+    ConjuntoItems nucleo0 = {{0, 0, lookahead_inicial}};
+    obtener_estado(nucleo0);
+
+    for (int X : g.orden_inicial) {
+        ConjuntoItems nucleo = nucleo_goto(estados[0].items, X, g);
+        if (!nucleo.empty()) {
+            obtener_estado(nucleo);
         }
+    }
 
-        if (right.size() == 1 && right[0] == "ε") {
-            right.clear();
+    for (size_t idx = 0; idx < estados.size(); ++idx) {
+        for (int X : g.orden_simbolos) {
+            ConjuntoItems nucleo = nucleo_goto(estados[idx].items, X, g);
+            if (!nucleo.empty()) {
+                int to_id = obtener_estado(nucleo);
+                estados[idx].transiciones.push_back({X, to_id});
+            }
         }
+    }
+    estadisticas.registrar_tiempo_goto(inicio, ns_cierre_inicial);
+    return automata;
+}
 
-        producciones.push_back({left, right});
+// Pool de hilos con robo de trabajo: cada hilo tiene su propia cola de rangos, toma del
+// final de la suya y, cuando se vacia, roba del principio de las demas.
+class PoolHilos {
+public:
+    explicit PoolHilos(int n) {
+        for (int i = 0; i < n; ++i) {
+            colas.emplace_back(new Cola);
+        }
+        for (int i = 0; i < n; ++i) {
+            hilos.emplace_back([this, i] { trabajar(i); });
+        }
     }
 
-    set<string> noTerminales;
-    for (const auto& prod : producciones) {
-        noTerminales.insert(prod.left);
+    ~PoolHilos() {
+        {
+            lock_guard<mutex> lock(m);
+            terminar = true;
+        }
+        cv_trabajo.notify_all();
+        for (auto& h : hilos) {
+            h.join();
+        }
     }
 
-    set<string> all_symbols;
-    for (const auto& prod : producciones) {
-        for (const auto& sym : prod.right)
-            all_symbols.insert(sym);
+    // Ejecuta f(i) para cada i en [0, n) y vuelve cuando todos terminaron.
+    void paralelo_para(size_t n, const function<void(size_t)>& f) {
+        if (n == 0) {
+            return;
+        }
+        size_t bloque = max<size_t>(1, n / (hilos.size() * 8));
+        size_t num_bloques = (n + bloque - 1) / bloque;
+        {
+            lock_guard<mutex> lock(m);
+            restantes = num_bloques;
+            for (size_t b = 0; b < num_bloques; ++b) {
+                Cola& cola = *colas[b % colas.size()];
+                lock_guard<mutex> lock_cola(cola.m);
+                cola.rangos.push_back({&f, b * bloque, min(n, (b + 1) * bloque)});
+            }
+            ++generacion;
+        }
+        cv_trabajo.notify_all();
+        unique_lock<mutex> lock(m);
+        cv_fin.wait(lock, [&] { return restantes == 0; });
     }
 
-    all_symbols.erase("ε");
+private:
+    // Cada rango lleva su funcion: un hilo que despierta tarde no puede ejecutar un
+    // rango de una llamada posterior con la funcion de la anterior.
+    struct Rango {
+        const function<void(size_t)>* f;
+        size_t inicio, fin;
+    };
 
-    vector<string> term_order = {"(", ")", "create", "paper", "$", "in_lv", "int", "comma", "out_lv", "assign", "nom", "identifier", "string", "float", "boolv", "boolf", "int_value", "string_value", "float_value", "boolv", "boolf", "in_op", "out_op", "then", "else", "while", "from", "to", "calculate", "in", "sqrt", "qbic", "similar", "less_than", "greater_than", "less_equal", "greater_equal", "not_equal", "increment", "decrement", "plus", "minus", "multi", "division", "power"}; 
-    vector<string> goto_order = {"S'", "P", "SL", "S", "CC", "D", "T", "V", "BO", "OP", "IF", "W", "F", "C", "R", "SQ", "QB", "A", "CN", "CM", "ID", "E", "EP", "TRM", "TP", "FC"};
+    struct Cola {
+        mutex m;
+        deque<Rango> rangos;
+    };
 
-    vector<string> terminales;
-    for (const auto& t : term_order) {
-        if (all_symbols.find(t) != all_symbols.end() || t == "$")
-            terminales.push_back(t);
-    }
-    for (const auto& sym : all_symbols) {
-        if (noTerminales.find(sym) == noTerminales.end() && find(terminales.begin(), terminales.end(), sym) == terminales.end())
-            terminales.push_back(sym);
-    }
-    if (find(terminales.begin(), terminales.end(), "$") == terminales.end())
-        terminales.push_back("$");
+    vector<thread> hilos;
+    vector<unique_ptr<Cola>> colas;
+    mutex m;
+    condition_variable cv_trabajo, cv_fin;
+    size_t restantes = 0;
+    uint64_t generacion = 0;
+    bool terminar = false;
 
-    vector<string> no_terminales;
-    for (const auto& nt : goto_order) {
-        if (noTerminales.find(nt) != noTerminales.end())
-            no_terminales.push_back(nt);
-    }
-    for (const auto& nt : noTerminales) {
-        if (find(no_terminales.begin(), no_terminales.end(), nt) == no_terminales.end())
-            no_terminales.push_back(nt);
+    bool tomar(int id, Rango& rango) {
+        for (size_t k = 0; k < colas.size(); ++k) {
+            Cola& cola = *colas[(id + k) % colas.size()];
+            lock_guard<mutex> lock(cola.m);
+            if (cola.rangos.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                rango = cola.rangos.back();
+                cola.rangos.pop_back();
+            } else {
+                rango = cola.rangos.front();
+                cola.rangos.pop_front();
+            }
+            return true;
+        }
+        return false;
     }
 
-    for (int i = 0; i < producciones.size(); ++i) {
-        cout << i << ": " << producciones[i].left << " -> ";
-        if (producciones[i].right.empty()) {
-            cout << "ε";
-        } else {
-            for (const auto& symbol : producciones[i].right) {
-                cout << symbol << " ";
+    void trabajar(int id) {
+        uint64_t vista = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(m);
+                cv_trabajo.wait(lock, [&] { return terminar || generacion != vista; });
+                if (terminar) {
+                    return;
+                }
+                vista = generacion;
+            }
+            Rango rango;
+            while (tomar(id, rango)) {
+                for (size_t i = rango.inicio; i < rango.fin; ++i) {
+                    (*rango.f)(i);
+                }
+                lock_guard<mutex> lock(m);
+                if (--restantes == 0) {
+                    cv_fin.notify_all();
+                }
             }
         }
-        cout << endl;
     }
+};
 
-    vector<set<Item>> estados;
-    map<set<Item>, int> estado_id;
-    map<int, map<string, string>> action;
-    map<int, map<string, int>> goto_table;
-    map<string, set<string>> memo;
-    set<Item> I0;
-    I0.insert({0, 0, "$"});
-    set<Item> closure0 = closure(I0, producciones, noTerminales, memo);
-    estados.push_back(closure0);
-    estado_id[closure0] = 0;
+// Mapa nucleo -> id repartido en fragmentos con su propio mutex.
+class MapaNucleosConcurrente {
+public:
+    typedef unordered_map<ConjuntoItems, int, HashItems> Fragmento;
 
-    for (const auto& X : goto_order) {
-        set<Item> goto0 = goto_fn(closure0, X, producciones, noTerminales, memo);
-        if (!goto0.empty() && !estado_id.count(goto0)) {
-            int nuevo_id = estados.size();
-            estados.push_back(goto0);
-            estado_id[goto0] = nuevo_id;
-        }
+    // Devuelve la entrada del nucleo, insertandola con valor si no existia.
+    pair<Fragmento::value_type*, bool> insertar(ConjuntoItems&& nucleo, size_t hash, int valor) {
+        Parte& parte = partes[hash % NUM_PARTES];
+        lock_guard<mutex> lock(parte.m);
+        auto res = parte.mapa.emplace(move(nucleo), valor);
+        return {&*res.first, res.second};
     }
 
-    for (size_t idx = 0; idx < estados.size(); ++idx) {
-        set<Item> I = estados[idx];
-        set<string> simbolos;
-        for (const auto& prod : producciones) {
-            for (const auto& s : prod.right) simbolos.insert(s);
+private:
+    static const int NUM_PARTES = 64;
+    struct Parte {
+        mutex m;
+        Fragmento mapa;
+    };
+    Parte partes[NUM_PARTES];
+};
+
+// Construccion por niveles: los sucesores de todo el frente se calculan en paralelo, los
+// nucleos nuevos se numeran en un paso secuencial recorriendo el frente en orden de id y
+// de simbolo, y sus cierres se calculan otra vez en paralelo. Asi los ids coinciden con
+// los de construir_automata sin importar el numero de hilos.
+template <typename Cierre>
+Automata construir_automata_paralelo(const Gramatica& g, const ConjuntoTerminales& lookahead_inicial, Cierre cerrar, int num_hilos) {
+    Automata automata;
+    vector<Estado>& estados = automata.estados;
+    MapaNucleosConcurrente estado_id;
+    HashItems hash_items;
+    PoolHilos pool(num_hilos);
+
+    auto obtener_estado = [&](ConjuntoItems&& nucleo) {
+        size_t h = hash_items(nucleo);
+        auto [entrada, nuevo] = estado_id.insertar(move(nucleo), h, estados.size());
+        estadisticas.registrar_busqueda(!nuevo);
+        if (nuevo) {
+            estados.push_back({entrada->first, {}, {}});
+        }
+        return entrada->second;
+    };
+
+    obtener_estado({{0, 0, lookahead_inicial}});
+    estados[0].items = cerrar(estados[0].nucleo);
+    for (int X : g.orden_inicial) {
+        ConjuntoItems nucleo = nucleo_goto(estados[0].items, X, g);
+        if (!nucleo.empty()) {
+            obtener_estado(move(nucleo));
         }
-        simbolos.insert("$"); 
-        simbolos.erase("ε"); 
-        for (const auto& X : simbolos) {
-            set<Item> goto_I_X = goto_fn(I, X, producciones, noTerminales, memo);
-            if (!goto_I_X.empty()) {
-                if (!estado_id.count(goto_I_X)) {
-                    int nuevo_id = estados.size();
-                    estados.push_back(goto_I_X);
-                    estado_id[goto_I_X] = nuevo_id;
+    }
+    pool.paralelo_para(estados.size() - 1, [&](size_t i) {
+        estados[i + 1].items = cerrar(estados[i + 1].nucleo);
+    });
+
+    // Mientras se procesa un frente, los nucleos sin id definitivo se guardan con un id
+    // provisional negativo; entrada_provisional[k] apunta a la entrada del provisional -1 - k.
+    atomic<int> siguiente_provisional(0);
+    vector<MapaNucleosConcurrente::Fragmento::value_type*> entrada_provisional;
+    mutex m_provisional;
+
+    size_t inicio = 0;
+    while (inicio < estados.size()) {
+        size_t fin = estados.size();
+        siguiente_provisional = 0;
+        entrada_provisional.clear();
+
+        // En este paso no hay cierres: todo el tiempo es de goto.
+        uint64_t inicio_goto = estadisticas.activas ? reloj_ns() : 0;
+        pool.paralelo_para(fin - inicio, [&](size_t k) {
+            Estado& estado = estados[inicio + k];
+            for (int X : g.orden_simbolos) {
+                ConjuntoItems nucleo = nucleo_goto(estado.items, X, g);
+                if (nucleo.empty()) {
+                    continue;
                 }
-                int to_id = estado_id[goto_I_X];
-                if (find(terminales.begin(), terminales.end(), X) != terminales.end()) {
-                    action[idx][X] = "s" + to_string(to_id);
-                } else if (find(no_terminales.begin(), no_terminales.end(), X) != no_terminales.end()) {
-                    goto_table[idx][X] = to_id;
+                size_t h = hash_items(nucleo);
+                int provisional = -1 - siguiente_provisional.fetch_add(1);
+                auto [entrada, nuevo] = estado_id.insertar(move(nucleo), h, provisional);
+                estadisticas.registrar_busqueda(!nuevo);
+                if (nuevo) {
+                    lock_guard<mutex> lock(m_provisional);
+                    if (entrada_provisional.size() <= size_t(-1 - provisional)) {
+                        entrada_provisional.resize(-provisional, nullptr);
+                    }
+                    entrada_provisional[-1 - provisional] = entrada;
                 }
+                estado.transiciones.push_back({X, entrada->second});
             }
-        }
+        });
 
-        for (const auto& it : I) {
-            const produccion& prod = producciones[it.idx];
-            if (it.dot_pos == prod.right.size()) { 
-                if (prod.left == "S'" && it.lookahead == "$") {
-                    action[idx]["$"] = "acc";
-                } else {
-                    action[idx][it.lookahead] = "r" + to_string(it.idx);
+        // Numeracion deterministica de los nucleos nuevos.
+        for (size_t idx = inicio; idx < fin; ++idx) {
+            for (auto& [X, destino] : estados[idx].transiciones) {
+                if (destino >= 0) {
+                    continue;
                 }
+                auto* entrada = entrada_provisional[-1 - destino];
+                if (entrada->second < 0) {
+                    entrada->second = estados.size();
+                    estados.push_back({entrada->first, {}, {}});
+                }
+                destino = entrada->second;
             }
         }
-    }
+        estadisticas.registrar_tiempo_goto(inicio_goto, estadisticas.ns_cierre);
 
-    cout << "\nLR(1) PARSING TABLE:\n";
+        pool.paralelo_para(estados.size() - fin, [&](size_t k) {
+            estados[fin + k].items = cerrar(estados[fin + k].nucleo);
+        });
+        inicio = fin;
+    }
+    return automata;
+}
+
+template <typename Cierre>
+Automata construir_automata(const Gramatica& g, const ConjuntoTerminales& lookahead_inicial, Cierre cerrar, int hilos) {
+    if (hilos > 1) {
+        return construir_automata_paralelo(g, lookahead_inicial, cerrar, hilos);
+    }
+    return construir_automata(g, lookahead_inicial, cerrar);
+}
+
+Automata construir_lr1(const Gramatica& g, const AnalisisGramatica& analisis, int hilos = 1) {
+    ConjuntoTerminales solo_fin(g.simbolos.num_terminales);
+    solo_fin.insertar(g.fin);
+    return construir_automata(g, solo_fin, [&](const ConjuntoItems& nucleo) {
+        return closure(nucleo, g, analisis);
+    }, hilos);
+}
+
+Automata construir_lr0(const Gramatica& g, int hilos = 1) {
+    return construir_automata(g, ConjuntoTerminales(g.simbolos.num_terminales), [&](const ConjuntoItems& nucleo) {
+        return closure_lr0(nucleo, g);
+    }, hilos);
+}
+
+// Algoritmo digraph de DeRemer y Pennello: F(x) = F'(x) ∪ ⋃{F(y) | x R y}, resolviendo
+// las componentes fuertemente conexas en un solo recorrido.
+void digraph(const vector<vector<int>>& R, vector<ConjuntoTerminales>& F) {
+    int n = R.size();
+    vector<int> N(n, 0);
+    vector<int> pila;
+    const int infinito = INT32_MAX;
+
+    function<void(int)> traverse = [&](int x) {
+        pila.push_back(x);
+        int d = pila.size();
+        N[x] = d;
+        for (int y : R[x]) {
+            if (N[y] == 0) {
+                traverse(y);
+            }
+            N[x] = min(N[x], N[y]);
+            F[x].unir(F[y]);
+        }
+        if (N[x] == d) {
+            while (true) {
+                int top = pila.back();
+                pila.pop_back();
+                N[top] = infinito;
+                if (top == x) {
+                    break;
+                }
+                F[top] = F[x];
+            }
+        }
+    };
+
+    for (int x = 0; x < n; ++x) {
+        if (N[x] == 0) {
+            traverse(x);
+        }
+    }
+}
+
+// LALR(1) sobre el automata LR(0) con las relaciones reads/includes/lookback de
+// DeRemer y Pennello. Solo los items completos reciben lookaheads.
+Automata construir_lalr(const Gramatica& g, const AnalisisGramatica& analisis, int hilos = 1) {
+    Automata automata = construir_lr0(g, hilos);
+    vector<Estado>& estados = automata.estados;
+    int S = g.simbolos.size();
+    int T = g.simbolos.num_terminales;
+
+    vector<int> ir(estados.size() * S, -1);
+    for (size_t p = 0; p < estados.size(); ++p) {
+        for (const auto& [X, q] : estados[p].transiciones) {
+            ir[p * S + X] = q;
+        }
+    }
+
+    // Transiciones no terminales (p, A). La transicion virtual (0, S') lleva "$".
+    map<pair<int, int>, int> trans_id;
+    vector<pair<int, int>> trans;
+    auto id_transicion = [&](int p, int A) {
+        auto it = trans_id.find({p, A});
+        if (it != trans_id.end()) {
+            return it->second;
+        }
+        int id = trans.size();
+        trans.push_back({p, A});
+        trans_id[{p, A}] = id;
+        return id;
+    };
+    int inicio = g.producciones[0].left;
+    id_transicion(0, inicio);
+    for (size_t p = 0; p < estados.size(); ++p) {
+        for (const auto& [X, q] : estados[p].transiciones) {
+            if (g.simbolos.es_no_terminal(X)) {
+                id_transicion(p, X);
+            }
+        }
+    }
+
+    int n = trans.size();
+    vector<ConjuntoTerminales> F(n, ConjuntoTerminales(T));
+    vector<vector<int>> reads(n), includes(n);
+    for (int x = 0; x < n; ++x) {
+        auto [p, A] = trans[x];
+        if (x == 0) {
+            F[x].insertar(g.fin);
+        }
+        int r = ir[p * S + A];
+        if (r < 0) {
+            continue;
+        }
+        for (const auto& [Y, destino] : estados[r].transiciones) {
+            if (g.simbolos.es_terminal(Y)) {
+                F[x].insertar(Y);
+            } else if (analisis.anulable[Y]) {
+                reads[x].push_back(id_transicion(r, Y));
+            }
+        }
+    }
+    digraph(reads, F);
+
+    // includes y lookback: se recorre cada produccion de B desde cada (p', B).
+    vector<vector<pair<int, int>>> lookback(estados.size());  // (produccion, transicion)
+    for (int x = 0; x < n; ++x) {
+        auto [p_origen, B] = trans[x];
+        for (int j : g.producciones_de[B]) {
+            const auto& right = g.producciones[j].right;
+            int p = p_origen;
+            for (size_t i = 0; i < right.size(); ++i) {
+                int A = right[i];
+                if (g.simbolos.es_no_terminal(A) && analisis.sufijo_anulable[j][i + 1]) {
+                    includes[trans_id.at({p, A})].push_back(x);
+                }
+                p = ir[p * S + A];
+            }
+            lookback[p].push_back({j, x});
+        }
+    }
+    digraph(includes, F);
+
+    for (size_t q = 0; q < estados.size(); ++q) {
+        for (const auto& [j, x] : lookback[q]) {
+            for (auto& item : estados[q].items) {
+                if (item.idx == j && item.dot_pos == g.producciones[j].right.size()) {
+                    item.lookahead.unir(F[x]);
+                }
+            }
+        }
+    }
+    return automata;
+}
+
+// Acciones de un estado como pares (terminal, accion) ordenados: -1 es el shift y i >= 0
+// la reduccion por el item i. Los estados con el mismo nucleo tienen los items en el mismo
+// orden, asi que i identifica la misma reduccion en todos ellos.
+typedef vector<pair<int, int>> AccionesEstado;
+
+AccionesEstado acciones_estado(const Estado& estado, const Gramatica& g) {
+    AccionesEstado acciones;
+    for (const auto& [X, destino] : estado.transiciones) {
+        if (g.simbolos.es_terminal(X)) {
+            acciones.push_back({X, -1});
+        }
+    }
+    for (size_t i = 0; i < estado.items.size(); ++i) {
+        if (estado.items[i].dot_pos == g.producciones[estado.items[i].idx].right.size()) {
+            estado.items[i].lookahead.para_cada([&](int t) {
+                acciones.push_back({t, int(i)});
+            });
+        }
+    }
+    sort(acciones.begin(), acciones.end());
+    return acciones;
+}
+
+// Unir estados es seguro si en cada terminal donde la union tiene mas de una accion, todo
+// miembro con alguna accion en ese terminal tiene exactamente esas mismas: construir_tabla
+// resuelve el conflicto solo a partir del conjunto de acciones, asi que la celda unida
+// queda igual que en cada miembro. Comparar solo que terminales tienen conflicto no
+// alcanza, porque dos conflictos distintos en el mismo terminal se resuelven distinto.
+bool union_compatible(const vector<const AccionesEstado*>& miembros) {
+    AccionesEstado todas;
+    for (const AccionesEstado* m : miembros) {
+        todas.insert(todas.end(), m->begin(), m->end());
+    }
+    sort(todas.begin(), todas.end());
+    todas.erase(unique(todas.begin(), todas.end()), todas.end());
+    for (size_t i = 0; i < todas.size();) {
+        size_t j = i;
+        while (j < todas.size() && todas[j].first == todas[i].first) ++j;
+        if (j - i > 1) {
+            for (const AccionesEstado* m : miembros) {
+                auto desde = lower_bound(m->begin(), m->end(), make_pair(todas[i].first, INT_MIN));
+                auto hasta = lower_bound(desde, m->end(), make_pair(todas[i].first + 1, INT_MIN));
+                if (desde != hasta && !equal(desde, hasta, todas.begin() + i, todas.begin() + j)) {
+                    return false;
+                }
+            }
+        }
+        i = j;
+    }
+    return true;
+}
+
+// LR(1) minimo: parte del automata canonico y une estados con el mismo nucleo siempre
+// que la union sea compatible (ver union_compatible). Despues se refina la particion
+// hasta que todos los estados de un bloque van a los mismos bloques. Refinar solo saca
+// miembros de un bloque, y con este criterio un subconjunto de un bloque compatible sigue
+// siendolo; igual se comprueba al final y un bloque que no lo fuera se separa en sus
+// estados y se vuelve a refinar.
+Automata minimizar_lr1(const Automata& canonico, const Gramatica& g) {
+    const vector<Estado>& estados = canonico.estados;
+    vector<AccionesEstado> acciones(estados.size());
+    for (size_t s = 0; s < estados.size(); ++s) {
+        acciones[s] = acciones_estado(estados[s], g);
+    }
+
+    map<vector<pair<int, int>>, vector<int>> por_nucleo;
+    for (size_t s = 0; s < estados.size(); ++s) {
+        vector<pair<int, int>> nucleo;
+        for (const auto& item : estados[s].nucleo) {
+            nucleo.push_back({item.idx, item.dot_pos});
+        }
+        por_nucleo[nucleo].push_back(s);
+    }
+
+    vector<int> bloque(estados.size(), -1);
+    int num_bloques = 0;
+    for (const auto& [nucleo, grupo] : por_nucleo) {
+        vector<vector<const AccionesEstado*>> bloques;
+        vector<int> ids;
+        for (int s : grupo) {
+            bool ubicado = false;
+            for (size_t b = 0; b < bloques.size() && !ubicado; ++b) {
+                vector<const AccionesEstado*> candidato = bloques[b];
+                candidato.push_back(&acciones[s]);
+                if (union_compatible(candidato)) {
+                    bloques[b] = candidato;
+                    bloque[s] = ids[b];
+                    ubicado = true;
+                }
+            }
+            if (!ubicado) {
+                bloques.push_back({&acciones[s]});
+                ids.push_back(num_bloques);
+                bloque[s] = num_bloques++;
+            }
+        }
+    }
+
+    while (true) {
+        bool cambio = true;
+        while (cambio) {
+            cambio = false;
+            map<pair<int, vector<int>>, int> firma_id;
+            vector<int> nuevo(estados.size());
+            for (size_t s = 0; s < estados.size(); ++s) {
+                vector<int> destinos;
+                for (const auto& [X, q] : estados[s].transiciones) {
+                    destinos.push_back(bloque[q]);
+                }
+                auto res = firma_id.emplace(make_pair(bloque[s], destinos), firma_id.size());
+                nuevo[s] = res.first->second;
+            }
+            if (firma_id.size() != num_bloques) {
+                cambio = true;
+                num_bloques = firma_id.size();
+            }
+            bloque = nuevo;
+        }
+
+        vector<vector<const AccionesEstado*>> miembros(num_bloques);
+        vector<vector<int>> estados_bloque(num_bloques);
+        for (size_t s = 0; s < estados.size(); ++s) {
+            miembros[bloque[s]].push_back(&acciones[s]);
+            estados_bloque[bloque[s]].push_back(s);
+        }
+        int separados = 0;
+        for (int b = 0; b < num_bloques; ++b) {
+            if (miembros[b].size() > 1 && !union_compatible(miembros[b])) {
+                for (size_t k = 1; k < estados_bloque[b].size(); ++k) {
+                    bloque[estados_bloque[b][k]] = num_bloques + separados++;
+                }
+            }
+        }
+        if (separados == 0) {
+            break;
+        }
+        num_bloques += separados;
+    }
+    // Los bloques se numeran por su primer estado canonico para que el resultado sea estable.
+    vector<int> representante(num_bloques, -1), numero(num_bloques, -1);
+    int siguiente = 0;
+    for (size_t s = 0; s < estados.size(); ++s) {
+        if (representante[bloque[s]] < 0) {
+            representante[bloque[s]] = s;
+            numero[bloque[s]] = siguiente++;
+        }
+    }
+
+    Automata minimo;
+    minimo.estados.resize(num_bloques);
+    for (size_t s = 0; s < estados.size(); ++s) {
+        Estado& destino = minimo.estados[numero[bloque[s]]];
+        if (representante[bloque[s]] == s) {
+            destino = estados[s];
+            for (auto& [X, q] : destino.transiciones) {
+                q = numero[bloque[q]];
+            }
+            continue;
+        }
+        for (size_t i = 0; i < destino.items.size(); ++i) {
+            destino.items[i].lookahead.unir(estados[s].items[i].lookahead);
+        }
+        for (size_t i = 0; i < destino.nucleo.size(); ++i) {
+            destino.nucleo[i].lookahead.unir(estados[s].nucleo[i].lookahead);
+        }
+    }
+    return minimo;
+}
+
+Automata construir_lr1_minimo(const Gramatica& g, const AnalisisGramatica& analisis, int hilos = 1) {
+    return minimizar_lr1(construir_lr1(g, analisis, hilos), g);
+}
+
+Automata construir_segun_modo(const string& modo, const Gramatica& g, const AnalisisGramatica& analisis, int hilos = 1) {
+    if (modo == "lalr") {
+        return construir_lalr(g, analisis, hilos);
+    }
+    if (modo == "minimo") {
+        return construir_lr1_minimo(g, analisis, hilos);
+    }
+    return construir_lr1(g, analisis, hilos);
+}
+
+// Regeneracion incremental del automata LR(1) canonico (--cache-automata archivo). La
+// cache guarda la gramatica con la que se construyo, FIRST y anulabilidad de cada no
+// terminal, y cada estado con su nucleo, su cierre y sus transiciones. Con la gramatica
+// nueva, las producciones se emparejan por texto y un no terminal cambia si cambio su
+// conjunto de producciones. Solo se recalculan los FIRST de los no terminales desde los que
+// se llega a uno cambiado. Un estado viejo queda intacto si ningun no terminal de su
+// cierre cambio de producciones, de FIRST ni de anulabilidad; entonces su cierre y sus
+// transiciones se toman de la cache en lugar de recalcular el cierre y probar goto con
+// cada simbolo. La numeracion de estados es la de construir_automata.
+const char MAGIA_CACHE[8] = {'L', 'R', '1', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t VERSION_CACHE = 1;
+
+// Cache leida. Los estados se quedan en el buffer: solo se decodifican los que se reutilizan.
+struct AutomataPrevio {
+    struct EstadoCache {
+        size_t nucleo, items, transiciones;  // desplazamientos en datos
+        uint32_t num_nucleo, num_items, num_transiciones;
+    };
+
+    TablaSimbolos simbolos;
+    vector<produccion> producciones;
+    vector<char> anulable;
+    vector<ConjuntoTerminales> first;
+    vector<EstadoCache> estados;
+    string datos;
+    size_t bytes_conjunto = 0;
+
+    uint32_t entero(size_t pos) const {
+        uint32_t v;
+        memcpy(&v, datos.data() + pos, sizeof(v));
+        return v;
+    }
+
+    size_t bytes_item() const {
+        return 2 * sizeof(uint32_t) + bytes_conjunto;
+    }
+};
+
+// Formato binario en el orden de bytes de la maquina: enteros de 32 bits, nombres con su
+// longitud delante y cada conjunto de terminales como sus palabras de 64 bits.
+bool guardar_cache_automata(const string& ruta, const Gramatica& g, const AnalisisGramatica& analisis, const Automata& automata) {
+    string datos(MAGIA_CACHE, sizeof(MAGIA_CACHE));
+    auto escribir = [&](uint32_t v) {
+        datos.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    };
+    auto escribir_conjunto = [&](const ConjuntoTerminales& c) {
+        datos.append(reinterpret_cast<const char*>(c.datos()), c.num_palabras() * sizeof(uint64_t));
+    };
+    auto escribir_items = [&](const ConjuntoItems& items) {
+        for (const auto& it : items) {
+            escribir(it.idx);
+            escribir(it.dot_pos);
+            escribir_conjunto(it.lookahead);
+        }
+    };
+
+    const TablaSimbolos& simbolos = g.simbolos;
+    escribir(VERSION_CACHE);
+    escribir(simbolos.size());
+    escribir(simbolos.num_terminales);
+    for (int id = 0; id < simbolos.size(); ++id) {
+        escribir(simbolos.nombre(id).size());
+        datos += simbolos.nombre(id);
+    }
+    escribir(g.producciones.size());
+    for (const auto& prod : g.producciones) {
+        escribir(prod.left);
+        escribir(prod.right.size());
+        for (int X : prod.right) {
+            escribir(X);
+        }
+    }
+    for (int A = simbolos.num_terminales; A < simbolos.size(); ++A) {
+        escribir(analisis.anulable[A]);
+        escribir_conjunto(analisis.first[A]);
+    }
+    escribir(automata.estados.size());
+    for (const auto& estado : automata.estados) {
+        escribir(estado.nucleo.size());
+        escribir(estado.items.size());
+        escribir(estado.transiciones.size());
+        escribir_items(estado.nucleo);
+        escribir_items(estado.items);
+        for (const auto& [X, destino] : estado.transiciones) {
+            escribir(X);
+            escribir(destino);
+        }
+    }
+
+    ofstream out(ruta, ios::binary);
+    if (!out.write(datos.data(), datos.size())) {
+        cerr << "Error: no se pudo escribir la cache '" << ruta << "'." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool cargar_cache_automata(const string& ruta, AutomataPrevio& previo, string& error) {
+    ifstream in(ruta, ios::binary | ios::ate);
+    string& datos = previo.datos;
+    datos.resize(in ? size_t(in.tellg()) : 0);
+    in.seekg(0);
+    in.read(&datos[0], datos.size());
+    size_t pos = sizeof(MAGIA_CACHE);
+    bool ok = in && datos.size() >= pos && memcmp(datos.data(), MAGIA_CACHE, pos) == 0;
+    auto hay = [&](size_t bytes) {
+        ok = ok && datos.size() - pos >= bytes;
+        return ok;
+    };
+    auto leer = [&]() {
+        uint32_t v = 0;
+        if (hay(sizeof(v))) {
+            v = previo.entero(pos);
+            pos += sizeof(v);
+        }
+        return v;
+    };
+    if (!ok || leer() != VERSION_CACHE) {
+        error = "'" + ruta + "' no es una cache de automata de esta version";
+        return false;
+    }
+
+    uint32_t num_simbolos = leer(), num_terminales = leer();
+    ok = ok && num_terminales <= num_simbolos;
+    for (uint32_t id = 0; ok && id < num_simbolos; ++id) {
+        uint32_t largo = leer();
+        ok = hay(largo) && previo.simbolos.agregar(datos.substr(pos, largo)) == int(id);
+        pos += largo;
+    }
+    previo.simbolos.num_terminales = num_terminales;
+
+    // Un conjunto valido no tiene bits fuera de [0, num_terminales).
+    ConjuntoTerminales vacio(num_terminales);
+    previo.bytes_conjunto = vacio.num_palabras() * sizeof(uint64_t);
+    uint64_t sobrantes = num_terminales % 64 ? ~uint64_t(0) << (num_terminales % 64) : 0;
+    auto saltar_conjunto = [&]() {
+        if (hay(previo.bytes_conjunto) && previo.bytes_conjunto > 0) {
+            uint64_t ultima;
+            memcpy(&ultima, datos.data() + pos + previo.bytes_conjunto - sizeof(ultima), sizeof(ultima));
+            ok = (ultima & sobrantes) == 0;
+        }
+        pos += previo.bytes_conjunto;
+    };
+    auto saltar_items = [&](uint32_t n) {
+        for (uint32_t k = 0; ok && k < n; ++k) {
+            uint32_t idx = leer(), dot_pos = leer();
+            ok = ok && idx < previo.producciones.size() && dot_pos <= previo.producciones[idx].right.size();
+            saltar_conjunto();
+        }
+    };
+
+    uint32_t num_producciones = leer();
+    for (uint32_t p = 0; ok && p < num_producciones; ++p) {
+        produccion prod{int(leer()), {}};
+        uint32_t largo = leer();
+        ok = ok && prod.left >= int(num_terminales) && prod.left < int(num_simbolos) && hay(largo * sizeof(uint32_t));
+        for (uint32_t k = 0; ok && k < largo; ++k) {
+            prod.right.push_back(leer());
+            ok = ok && prod.right.back() >= 0 && prod.right.back() < int(num_simbolos);
+        }
+        previo.producciones.push_back(move(prod));
+    }
+    previo.anulable.assign(num_simbolos, 0);
+    previo.first.assign(num_simbolos, vacio);
+    for (uint32_t A = num_terminales; ok && A < num_simbolos; ++A) {
+        previo.anulable[A] = leer() != 0;
+        size_t inicio = pos;
+        saltar_conjunto();
+        if (ok) {
+            memcpy(previo.first[A].datos(), datos.data() + inicio, previo.bytes_conjunto);
+        }
+    }
+    uint32_t num_estados = leer();
+    for (uint32_t s = 0; ok && s < num_estados; ++s) {
+        AutomataPrevio::EstadoCache e;
+        e.num_nucleo = leer();
+        e.num_items = leer();
+        e.num_transiciones = leer();
+        e.nucleo = pos;
+        saltar_items(e.num_nucleo);
+        e.items = pos;
+        saltar_items(e.num_items);
+        e.transiciones = pos;
+        for (uint32_t k = 0; ok && k < e.num_transiciones; ++k) {
+            uint32_t X = leer(), destino = leer();
+            ok = ok && X < num_simbolos && destino < num_estados;
+        }
+        previo.estados.push_back(e);
+    }
+    if (!ok || pos != datos.size()) {
+        error = "cache de automata '" + ruta + "' corrupta";
+        return false;
+    }
+    return true;
+}
+
+// Correspondencia entre la cache y la gramatica nueva, y los estados que siguen valiendo.
+struct Regeneracion {
+    const AutomataPrevio* previo = nullptr;
+    AnalisisGramatica analisis;
+    vector<int> simbolo_nuevo;
+    vector<int> produccion_nueva;
+    bool identidad = false;  // los terminales conservan sus ids
+    int num_terminales = 0;
+    vector<ConjuntoItems> nucleos;  // por estado viejo; vacio si no se puede traducir
+    unordered_map<ConjuntoItems, int, HashItems> intactos;  // nucleo -> estado viejo
+    int no_terminales_cambiados = 0;
+    int first_recalculados = 0;
+    int first_cambiados = 0;
+
+    // Pasa un conjunto de terminales a los ids nuevos; falla si alguno ya no existe.
+    bool traducir_terminales(const uint64_t* palabras, ConjuntoTerminales& nuevo) const {
+        nuevo = ConjuntoTerminales(num_terminales);
+        if (identidad) {
+            memcpy(nuevo.datos(), palabras, previo->bytes_conjunto);
+            return true;
+        }
+        for (size_t i = 0; i < previo->bytes_conjunto / sizeof(uint64_t); ++i) {
+            for (uint64_t w = palabras[i]; w; w &= w - 1) {
+                int t = simbolo_nuevo[i * 64 + __builtin_ctzll(w)];
+                if (t < 0) {
+                    return false;
+                }
+                nuevo.insertar(t);
+            }
+        }
+        return true;
+    }
+
+    bool traducir_items(size_t pos, uint32_t n, ConjuntoItems& items) const {
+        items.resize(n);
+        vector<uint64_t> palabras(previo->bytes_conjunto / sizeof(uint64_t));
+        for (auto& it : items) {
+            it.idx = produccion_nueva[previo->entero(pos)];
+            it.dot_pos = previo->entero(pos + sizeof(uint32_t));
+            memcpy(palabras.data(), previo->datos.data() + pos + 2 * sizeof(uint32_t), previo->bytes_conjunto);
+            pos += previo->bytes_item();
+            if (it.idx < 0 || !traducir_terminales(palabras.data(), it.lookahead)) {
+                items.clear();
+                return false;
+            }
+        }
+        sort(items.begin(), items.end(), menor_nucleo);
+        return true;
+    }
+};
+
+Regeneracion preparar_regeneracion(const Gramatica& g, const AutomataPrevio& previo) {
+    Regeneracion r;
+    r.previo = &previo;
+    const TablaSimbolos& simbolos = g.simbolos;
+    const TablaSimbolos& viejos = previo.simbolos;
+    int T = r.num_terminales = simbolos.num_terminales;
+
+    // Un simbolo viejo se corresponde con el nuevo del mismo nombre si sigue siendo de la
+    // misma clase.
+    vector<int>& simbolo_nuevo = r.simbolo_nuevo;
+    vector<int> simbolo_viejo(simbolos.size(), -1);
+    simbolo_nuevo.assign(viejos.size(), -1);
+    for (int v = 0; v < viejos.size(); ++v) {
+        int id = simbolos.id(viejos.nombre(v));
+        if (id >= 0 && simbolos.es_terminal(id) == viejos.es_terminal(v)) {
+            simbolo_nuevo[v] = id;
+            simbolo_viejo[id] = v;
+        }
+    }
+    r.identidad = viejos.num_terminales == T;
+    for (int t = 0; t < viejos.num_terminales; ++t) {
+        r.identidad = r.identidad && simbolo_nuevo[t] == t;
+    }
+
+    // Producciones emparejadas por texto; las repetidas, en orden de aparicion.
+    map<pair<int, vector<int>>, vector<int>> nuevas_por_texto;
+    for (size_t p = g.producciones.size(); p-- > 0;) {
+        nuevas_por_texto[{g.producciones[p].left, g.producciones[p].right}].push_back(p);
+    }
+    r.produccion_nueva.assign(previo.producciones.size(), -1);
+    vector<char> emparejada(g.producciones.size(), 0);
+    vector<char> cambiado(simbolos.size(), 0);
+    for (size_t p = 0; p < previo.producciones.size(); ++p) {
+        const produccion& prod = previo.producciones[p];
+        pair<int, vector<int>> texto = {simbolo_nuevo[prod.left], {}};
+        bool existe = texto.first >= 0;
+        for (int X : prod.right) {
+            existe = existe && simbolo_nuevo[X] >= 0;
+            texto.second.push_back(simbolo_nuevo[X]);
+        }
+        auto it = existe ? nuevas_por_texto.find(texto) : nuevas_por_texto.end();
+        if (it != nuevas_por_texto.end() && !it->second.empty()) {
+            r.produccion_nueva[p] = it->second.back();
+            emparejada[it->second.back()] = 1;
+            it->second.pop_back();
+        } else if (texto.first >= 0) {
+            cambiado[texto.first] = 1;
+        }
+    }
+    for (size_t p = 0; p < g.producciones.size(); ++p) {
+        if (!emparejada[p]) {
+            cambiado[g.producciones[p].left] = 1;
+        }
+    }
+
+    // FIRST y anulables viejos, traducidos; los que no se pueden traducir se recalculan.
+    AnalisisGramatica& analisis = r.analisis;
+    analisis.anulable.assign(simbolos.size(), 0);
+    analisis.first.assign(simbolos.size(), ConjuntoTerminales(T));
+    for (int t = 0; t < T; ++t) {
+        analisis.first[t].insertar(t);
+    }
+    vector<ConjuntoTerminales> first_viejo(simbolos.size());
+    vector<char> afectado(simbolos.size(), 0), con_previo(simbolos.size(), 0);
+    vector<int> pendientes;
+    for (int A = T; A < simbolos.size(); ++A) {
+        int v = simbolo_viejo[A];
+        con_previo[A] = v >= 0 && r.traducir_terminales(previo.first[v].datos(), first_viejo[A]);
+        if (cambiado[A] || !con_previo[A]) {
+            afectado[A] = 1;
+            pendientes.push_back(A);
+        }
+        r.no_terminales_cambiados += cambiado[A];
+    }
+
+    // Un FIRST puede cambiar si desde su no terminal se llega a uno afectado.
+    vector<vector<int>> usado_por(simbolos.size());
+    for (const auto& prod : g.producciones) {
+        for (int X : prod.right) {
+            if (simbolos.es_no_terminal(X)) {
+                usado_por[X].push_back(prod.left);
+            }
+        }
+    }
+    while (!pendientes.empty()) {
+        int B = pendientes.back();
+        pendientes.pop_back();
+        for (int A : usado_por[B]) {
+            if (!afectado[A]) {
+                afectado[A] = 1;
+                pendientes.push_back(A);
+            }
+        }
+    }
+
+    vector<produccion> a_recalcular;
+    for (int A = T; A < simbolos.size(); ++A) {
+        if (!afectado[A]) {
+            analisis.first[A] = first_viejo[A];
+            analisis.anulable[A] = previo.anulable[simbolo_viejo[A]];
+            continue;
+        }
+        ++r.first_recalculados;
+        for (int p : g.producciones_de[A]) {
+            a_recalcular.push_back(g.producciones[p]);
+        }
+    }
+    punto_fijo_first(analisis, a_recalcular);
+    calcular_sufijos(analisis, g.producciones, T);
+    vector<char> first_cambiado(simbolos.size(), 0);
+    for (int A = T; A < simbolos.size(); ++A) {
+        first_cambiado[A] = afectado[A] && (!con_previo[A] || !(analisis.first[A] == first_viejo[A])
+                                            || analisis.anulable[A] != previo.anulable[simbolo_viejo[A]]);
+        r.first_cambiados += first_cambiado[A];
+    }
+
+    // El cierre de un item [A -> α.Bβ] depende de las producciones de B y de FIRST y
+    // anulabilidad de los simbolos de β; item_intacto[p][punto] dice si nada de eso cambio.
+    vector<vector<char>> item_intacto(previo.producciones.size());
+    for (size_t p = 0; p < previo.producciones.size(); ++p) {
+        const vector<int>& right = previo.producciones[p].right;
+        vector<char>& intacto = item_intacto[p];
+        intacto.assign(right.size() + 1, r.produccion_nueva[p] >= 0);
+        bool sufijo_intacto = true;
+        for (int i = int(right.size()) - 1; i >= 0; --i) {
+            int X = right[i];
+            if (viejos.es_no_terminal(X)) {
+                int B = simbolo_nuevo[X];
+                intacto[i] = intacto[i] && sufijo_intacto && B >= 0 && !cambiado[B];
+                sufijo_intacto = sufijo_intacto && B >= 0 && !first_cambiado[B];
+            }
+        }
+    }
+
+    r.nucleos.resize(previo.estados.size());
+    for (size_t s = 0; s < previo.estados.size(); ++s) {
+        r.traducir_items(previo.estados[s].nucleo, previo.estados[s].num_nucleo, r.nucleos[s]);
+    }
+    for (size_t s = 0; s < previo.estados.size(); ++s) {
+        const AutomataPrevio::EstadoCache& e = previo.estados[s];
+        bool intacto = !r.nucleos[s].empty();
+        for (uint32_t k = 0; intacto && k < e.num_items; ++k) {
+            size_t pos = e.items + k * previo.bytes_item();
+            intacto = item_intacto[previo.entero(pos)][previo.entero(pos + sizeof(uint32_t))];
+        }
+        for (uint32_t k = 0; intacto && k < e.num_transiciones; ++k) {
+            intacto = !r.nucleos[previo.entero(e.transiciones + (2 * k + 1) * sizeof(uint32_t))].empty();
+        }
+        if (intacto) {
+            r.intactos.emplace(r.nucleos[s], s);
+        }
+    }
+    return r;
+}
+
+// construir_automata, salvo que los estados intactos de la cache no se cierran ni se
+// prueban con cada simbolo: sus transiciones se copian de la cache.
+Automata construir_lr1_reutilizando(const Gramatica& g, const Regeneracion& r, size_t& reutilizados) {
+    uint64_t inicio = estadisticas.activas ? reloj_ns() : 0;
+    uint64_t ns_cierre_inicial = estadisticas.ns_cierre;
+    const AutomataPrevio& previo = *r.previo;
+    Automata automata;
+    vector<Estado>& estados = automata.estados;
+    unordered_map<ConjuntoItems, int, HashItems> estado_id;
+    vector<int> previo_de;
+
+    auto obtener_estado = [&](const ConjuntoItems& nucleo) {
+        auto it = estado_id.find(nucleo);
+        estadisticas.registrar_busqueda(it != estado_id.end());
+        if (it != estado_id.end()) {
+            return it->second;
+        }
+        int nuevo_id = estados.size();
+        estados.push_back({nucleo, {}, {}});
+        auto intacto = r.intactos.find(nucleo);
+        int s = intacto == r.intactos.end() ? -1 : intacto->second;
+        if (s >= 0 && r.traducir_items(previo.estados[s].items, previo.estados[s].num_items, estados.back().items)) {
+            ++reutilizados;
+        } else {
+            estados.back().items = closure(nucleo, g, r.analisis);
+            s = -1;
+        }
+        previo_de.push_back(s);
+        estado_id.emplace(nucleo, nuevo_id);
+        return nuevo_id;
+    };
+
+    ConjuntoTerminales solo_fin(g.simbolos.num_terminales);
+    solo_fin.insertar(g.fin);
+    obtener_estado({{0, 0, solo_fin}});
+    for (int X : g.orden_inicial) {
+        ConjuntoItems nucleo = nucleo_goto(estados[0].items, X, g);
+        if (!nucleo.empty()) {
+            obtener_estado(nucleo);
+        }
+    }
+
+    // Las transiciones de la cache se recorren en el orden de g.orden_simbolos.
+    vector<int> orden(g.simbolos.size(), -1);
+    for (size_t k = 0; k < g.orden_simbolos.size(); ++k) {
+        orden[g.orden_simbolos[k]] = k;
+    }
+    vector<pair<int, int>> transiciones;
+    for (size_t idx = 0; idx < estados.size(); ++idx) {
+        if (previo_de[idx] >= 0) {
+            const AutomataPrevio::EstadoCache& e = previo.estados[previo_de[idx]];
+            transiciones.clear();
+            for (uint32_t k = 0; k < e.num_transiciones; ++k) {
+                int X = r.simbolo_nuevo[previo.entero(e.transiciones + 2 * k * sizeof(uint32_t))];
+                transiciones.push_back({X, int(previo.entero(e.transiciones + (2 * k + 1) * sizeof(uint32_t)))});
+            }
+            sort(transiciones.begin(), transiciones.end(), [&](const pair<int, int>& a, const pair<int, int>& b) {
+                return orden[a.first] < orden[b.first];
+            });
+            for (const auto& [X, destino] : transiciones) {
+                int to_id = obtener_estado(r.nucleos[destino]);
+                estados[idx].transiciones.push_back({X, to_id});
+            }
+            continue;
+        }
+        // Los nucleos de goto de un estado nuevo salen de una sola pasada por sus items,
+        // agrupados por el simbolo despues del punto, en lugar de una pasada por simbolo.
+        transiciones.clear();
+        const ConjuntoItems& items = estados[idx].items;
+        for (size_t i = 0; i < items.size(); ++i) {
+            const produccion& prod = g.producciones[items[i].idx];
+            if (items[i].dot_pos < prod.right.size() && orden[prod.right[items[i].dot_pos]] >= 0) {
+                transiciones.push_back({orden[prod.right[items[i].dot_pos]], i});
+            }
+        }
+        sort(transiciones.begin(), transiciones.end());
+        // obtener_estado puede agregar estados e invalidar items: primero se arman todos
+        // los nucleos.
+        vector<pair<int, ConjuntoItems>> sucesores;
+        for (size_t i = 0; i < transiciones.size(); ++i) {
+            if (i == 0 || transiciones[i].first != transiciones[i - 1].first) {
+                sucesores.push_back({g.orden_simbolos[transiciones[i].first], {}});
+            }
+            const Item& it = items[transiciones[i].second];
+            sucesores.back().second.push_back({it.idx, it.dot_pos + 1, it.lookahead});
+        }
+        for (const auto& [X, nucleo] : sucesores) {
+            estadisticas.registrar_goto(nucleo.size());
+            int to_id = obtener_estado(nucleo);
+            estados[idx].transiciones.push_back({X, to_id});
+        }
+    }
+    estadisticas.registrar_tiempo_goto(inicio, ns_cierre_inicial);
+    return automata;
+}
+
+// Construye el automata de la gramatica reutilizando la cache y la actualiza. Sin cache
+// previa, o si no se puede leer, se construye todo.
+bool regenerar_automata(const string& ruta, const string& modo, const Gramatica& g, int hilos,
+                        AnalisisGramatica& analisis, Automata& automata) {
+    AutomataPrevio previo;
+    Regeneracion r;
+    bool hay_previo = filesystem::exists(ruta);
+    string error;
+    if (hay_previo) {
+        estadisticas.medir_fase("carga de cache", [&] { hay_previo = cargar_cache_automata(ruta, previo, error); });
+        if (!hay_previo) {
+            cerr << "Aviso: " << error << "; se reconstruye el automata completo." << endl;
+        }
+    }
+
+    Automata canonico;
+    size_t reutilizados = 0;
+    if (hay_previo) {
+        estadisticas.medir_fase("FIRST", [&] { r = preparar_regeneracion(g, previo); });
+        estadisticas.medir_fase("automata", [&] { canonico = construir_lr1_reutilizando(g, r, reutilizados); });
+    } else {
+        estadisticas.medir_fase("FIRST", [&] { r.analisis = analizar_gramatica(g.producciones, g.simbolos); });
+        estadisticas.medir_fase("automata", [&] { canonico = construir_lr1(g, r.analisis, hilos); });
+    }
+
+    cout << "Cache de automata: " << reutilizados << " de " << canonico.estados.size() << " estados reutilizados";
+    if (hay_previo) {
+        cout << ", " << r.no_terminales_cambiados << " no terminales cambiados, "
+             << r.first_recalculados << " FIRST recalculados (" << r.first_cambiados << " distintos)";
+    }
+    cout << "." << endl;
+    bool guardada;
+    estadisticas.medir_fase("guardado de cache", [&] { guardada = guardar_cache_automata(ruta, g, r.analisis, canonico); });
+    if (!guardada) {
+        return false;
+    }
+    analisis = move(r.analisis);
+    if (modo == "minimo") {
+        estadisticas.medir_fase("minimizacion", [&] { automata = minimizar_lr1(canonico, g); });
+    } else {
+        automata = move(canonico);
+    }
+    return true;
+}
+
+// Accion empaquetada en 32 bits: los 2 bits altos indican el tipo y el resto el destino
+// (estado para SHIFT, produccion para REDUCE). Una celda vacia vale 0, es decir ERROR.
+enum class TipoAccion : uint32_t {
+    ERROR,
+    SHIFT,
+    REDUCE,
+    ACCEPT
+};
+
+inline uint32_t empaquetar(TipoAccion tipo, uint32_t destino) {
+    return uint32_t(tipo) << 30 | destino;
+}
+
+inline TipoAccion tipo_accion(uint32_t accion) {
+    return TipoAccion(accion >> 30);
+}
+
+inline uint32_t destino_accion(uint32_t accion) {
+    return accion & 0x3FFFFFFF;
+}
+
+// Tablas ACTION/GOTO densas, indexadas por estado y por terminal (o por no terminal
+// relativo a num_terminales). prod_izq y prod_len bastan para reducir sin la gramatica.
+struct TablaLR {
+    int num_estados = 0;
+    int num_terminales = 0;
+    int num_no_terminales = 0;
+    int fin = 0;
+    vector<uint32_t> acciones;
+    vector<int32_t> gotos;
+    vector<int32_t> prod_izq;
+    vector<int32_t> prod_len;
+
+    uint32_t accion(int estado, int terminal) const {
+        return acciones[size_t(estado) * num_terminales + terminal];
+    }
+
+    int32_t ir_a(int estado, int no_terminal) const {
+        return gotos[size_t(estado) * num_no_terminales + no_terminal];
+    }
+};
+
+// Los conflictos se resuelven como siempre: primero los shifts y luego las reducciones en
+// orden de item, quedando la ultima escrita.
+TablaLR construir_tabla(const Automata& automata, const Gramatica& g) {
+    TablaLR tabla;
+    const TablaSimbolos& simbolos = g.simbolos;
+    tabla.num_estados = automata.estados.size();
+    tabla.num_terminales = simbolos.num_terminales;
+    tabla.num_no_terminales = simbolos.size() - simbolos.num_terminales;
+    tabla.fin = g.fin;
+    tabla.acciones.assign(size_t(tabla.num_estados) * tabla.num_terminales, 0);
+    tabla.gotos.assign(size_t(tabla.num_estados) * tabla.num_no_terminales, -1);
+    for (const auto& prod : g.producciones) {
+        tabla.prod_izq.push_back(prod.left - simbolos.num_terminales);
+        tabla.prod_len.push_back(prod.right.size());
+    }
+
+    for (int idx = 0; idx < tabla.num_estados; ++idx) {
+        const Estado& estado = automata.estados[idx];
+        uint32_t* fila = &tabla.acciones[size_t(idx) * tabla.num_terminales];
+        for (const auto& [X, to_id] : estado.transiciones) {
+            if (simbolos.es_terminal(X)) {
+                fila[X] = empaquetar(TipoAccion::SHIFT, to_id);
+            } else {
+                tabla.gotos[size_t(idx) * tabla.num_no_terminales + X - simbolos.num_terminales] = to_id;
+            }
+        }
+
+        for (const auto& it : estado.items) {
+            if (it.dot_pos == g.producciones[it.idx].right.size()) {
+                it.lookahead.para_cada([&](int t) {
+                    if (it.idx == 0 && t == g.fin) {
+                        fila[t] = empaquetar(TipoAccion::ACCEPT, 0);
+                    } else {
+                        fila[t] = empaquetar(TipoAccion::REDUCE, it.idx);
+                    }
+                });
+            }
+        }
+    }
+    return tabla;
+}
+
+// Vector peine (row displacement): cada fila i de una tabla dispersa se coloca a partir de
+// base[i] dentro de un arreglo comun, y check[] dice a que fila pertenece cada casilla.
+struct VectorPeine {
+    vector<int32_t> base;
+    vector<int32_t> check;
+    vector<uint32_t> valor;
+
+    // filas[i] son los pares (columna, valor) explicitos de la fila i.
+    void construir(const vector<vector<pair<int, uint32_t>>>& filas) {
+        base.assign(filas.size(), 0);
+        check.clear();
+        valor.clear();
+        vector<int> orden(filas.size());
+        for (size_t i = 0; i < orden.size(); ++i) orden[i] = i;
+        stable_sort(orden.begin(), orden.end(), [&](int a, int b) {
+            return filas[a].size() > filas[b].size();
+        });
+
+        size_t primer_libre = 0;
+        for (int f : orden) {
+            if (filas[f].empty()) {
+                continue;
+            }
+            while (primer_libre < check.size() && check[primer_libre] >= 0) ++primer_libre;
+            int minima = filas[f].front().first;
+            for (int b = int(primer_libre) - minima; ; ++b) {
+                bool cabe = true;
+                for (const auto& [col, v] : filas[f]) {
+                    if (b + col < 0 || (b + col < check.size() && check[b + col] >= 0)) {
+                        cabe = false;
+                        break;
+                    }
+                }
+                if (!cabe) {
+                    continue;
+                }
+                base[f] = b;
+                for (const auto& [col, v] : filas[f]) {
+                    if (b + col >= check.size()) {
+                        check.resize(b + col + 1, -1);
+                        valor.resize(b + col + 1, 0);
+                    }
+                    check[b + col] = f;
+                    valor[b + col] = v;
+                }
+                break;
+            }
+        }
+    }
+
+    size_t bytes() const {
+        return base.size() * sizeof(int32_t) + check.size() * sizeof(int32_t) + valor.size() * sizeof(uint32_t);
+    }
+};
+
+// Vista sin propiedad de un vector peine; apunta a los arreglos de un VectorPeine o
+// directamente a un archivo de tablas mapeado en memoria.
+struct VistaPeine {
+    const int32_t* base = nullptr;
+    const int32_t* check = nullptr;
+    const uint32_t* valor = nullptr;
+    size_t tamano = 0;
+
+    bool buscar(int fila, int columna, uint32_t& v) const {
+        size_t i = size_t(base[fila] + columna);
+        if (i < tamano && check[i] == fila) {
+            v = valor[i];
+            return true;
+        }
+        return false;
+    }
+};
+
+struct VistaComprimida {
+    int num_estados = 0;
+    int num_terminales = 0;
+    int num_no_terminales = 0;
+    int fin = 0;
+    const int32_t* fila_accion = nullptr;
+    const uint32_t* accion_defecto = nullptr;
+    VistaPeine peine_accion;
+    const int32_t* goto_defecto = nullptr;
+    VistaPeine peine_goto;
+    const int32_t* prod_izq = nullptr;
+    const int32_t* prod_len = nullptr;
+
+    uint32_t accion(int estado, int terminal) const {
+        uint32_t v;
+        if (peine_accion.buscar(fila_accion[estado], terminal, v)) {
+            return v;
+        }
+        return accion_defecto[estado];
+    }
+
+    int32_t ir_a(int estado, int no_terminal) const {
+        uint32_t v;
+        if (peine_goto.buscar(no_terminal, estado, v)) {
+            return int32_t(v);
+        }
+        return goto_defecto[no_terminal];
+    }
+};
+
+// ACTION y GOTO comprimidas. Cada estado tiene una reduccion por defecto (la mas frecuente
+// de su fila) que reemplaza a sus celdas vacias, y los estados con filas iguales comparten
+// una sola fila del vector peine. GOTO se comprime por columnas con un destino por defecto
+// por no terminal, ya que solo se consulta en pares (estado, A) validos.
+struct TablaComprimida {
+    int num_estados = 0;
+    int num_terminales = 0;
+    int num_no_terminales = 0;
+    int fin = 0;
+    vector<int32_t> fila_accion;      // por estado: fila compartida en el peine de ACTION
+    vector<uint32_t> accion_defecto;  // por estado
+    VectorPeine peine_accion;
+    vector<int32_t> goto_defecto;     // por no terminal
+    VectorPeine peine_goto;           // filas = no terminales, columnas = estados
+    vector<int32_t> prod_izq;
+    vector<int32_t> prod_len;
+
+    VistaComprimida vista() const;
+
+    size_t bytes() const {
+        return fila_accion.size() * sizeof(int32_t) + accion_defecto.size() * sizeof(uint32_t) + peine_accion.bytes()
+            + goto_defecto.size() * sizeof(int32_t) + peine_goto.bytes()
+            + (prod_izq.size() + prod_len.size()) * sizeof(int32_t);
+    }
+};
+
+VistaComprimida TablaComprimida::vista() const {
+    VistaComprimida v;
+    v.num_estados = num_estados;
+    v.num_terminales = num_terminales;
+    v.num_no_terminales = num_no_terminales;
+    v.fin = fin;
+    v.fila_accion = fila_accion.data();
+    v.accion_defecto = accion_defecto.data();
+    v.peine_accion = {peine_accion.base.data(), peine_accion.check.data(), peine_accion.valor.data(), peine_accion.check.size()};
+    v.goto_defecto = goto_defecto.data();
+    v.peine_goto = {peine_goto.base.data(), peine_goto.check.data(), peine_goto.valor.data(), peine_goto.check.size()};
+    v.prod_izq = prod_izq.data();
+    v.prod_len = prod_len.data();
+    return v;
+}
+
+TablaComprimida comprimir_tabla(const TablaLR& tabla) {
+    TablaComprimida c;
+    c.num_estados = tabla.num_estados;
+    c.num_terminales = tabla.num_terminales;
+    c.num_no_terminales = tabla.num_no_terminales;
+    c.fin = tabla.fin;
+    c.prod_izq = tabla.prod_izq;
+    c.prod_len = tabla.prod_len;
+
+    map<pair<uint32_t, vector<pair<int, uint32_t>>>, int> fila_id;
+    vector<vector<pair<int, uint32_t>>> filas;
+    for (int e = 0; e < tabla.num_estados; ++e) {
+        map<uint32_t, int> reducciones;
+        for (int t = 0; t < tabla.num_terminales; ++t) {
+            if (tipo_accion(tabla.accion(e, t)) == TipoAccion::REDUCE) {
+                reducciones[tabla.accion(e, t)]++;
+            }
+        }
+        uint32_t defecto = 0;
+        int mas_frecuente = 0;
+        for (const auto& [accion, veces] : reducciones) {
+            if (veces > mas_frecuente) {
+                defecto = accion;
+                mas_frecuente = veces;
+            }
+        }
+
+        vector<pair<int, uint32_t>> explicitas;
+        for (int t = 0; t < tabla.num_terminales; ++t) {
+            uint32_t accion = tabla.accion(e, t);
+            if (accion != defecto && accion != 0) {
+                explicitas.push_back({t, accion});
+            }
+        }
+        auto res = fila_id.emplace(make_pair(defecto, explicitas), filas.size());
+        if (res.second) {
+            filas.push_back(explicitas);
+        }
+        c.fila_accion.push_back(res.first->second);
+        c.accion_defecto.push_back(defecto);
+    }
+    c.peine_accion.construir(filas);
+
+    vector<vector<pair<int, uint32_t>>> columnas(tabla.num_no_terminales);
+    for (int A = 0; A < tabla.num_no_terminales; ++A) {
+        map<int32_t, int> destinos;
+        for (int e = 0; e < tabla.num_estados; ++e) {
+            if (tabla.ir_a(e, A) >= 0) {
+                destinos[tabla.ir_a(e, A)]++;
+            }
+        }
+        int32_t defecto = -1;
+        int mas_frecuente = 0;
+        for (const auto& [destino, veces] : destinos) {
+            if (veces > mas_frecuente) {
+                defecto = destino;
+                mas_frecuente = veces;
+            }
+        }
+        c.goto_defecto.push_back(defecto);
+        for (int e = 0; e < tabla.num_estados; ++e) {
+            if (tabla.ir_a(e, A) >= 0 && tabla.ir_a(e, A) != defecto) {
+                columnas[A].push_back({e, uint32_t(tabla.ir_a(e, A))});
+            }
+        }
+    }
+    c.peine_goto.construir(columnas);
+    return c;
+}
+
+size_t bytes_tabla_densa(const TablaLR& tabla) {
+    return tabla.acciones.size() * sizeof(uint32_t) + tabla.gotos.size() * sizeof(int32_t)
+        + (tabla.prod_izq.size() + tabla.prod_len.size()) * sizeof(int32_t);
+}
+
+string accion_texto(uint32_t accion) {
+    switch (tipo_accion(accion)) {
+        case TipoAccion::SHIFT: return "s" + to_string(destino_accion(accion));
+        case TipoAccion::REDUCE: return "r" + to_string(destino_accion(accion));
+        case TipoAccion::ACCEPT: return "acc";
+        default: return "";
+    }
+}
+
+void imprimir_tabla(const Gramatica& g, const TablaLR& tabla, const string& modo) {
+    const TablaSimbolos& simbolos = g.simbolos;
+    const vector<produccion>& producciones = g.producciones;
+    for (int i = 0; i < producciones.size(); ++i) {
+        cout << i << ": " << simbolos.nombre(producciones[i].left) << " -> ";
+        if (producciones[i].right.empty()) {
+            cout << "ε";
+        } else {
+            for (int symbol : producciones[i].right) {
+                cout << simbolos.nombre(symbol) << " ";
+            }
+        }
+        cout << endl;
+    }
+
+    if (modo == "lalr") cout << "\nLALR(1) PARSING TABLE:\n";
+    else cout << "\nLR(1) PARSING TABLE:\n";
     cout << "State\t";
-    for (const auto& t : terminales) cout << t << "\t";
+    for (int id = 0; id < simbolos.size(); ++id) cout << simbolos.nombre(id) << "\t";
+    cout << endl;
+    for (int i = 0; i < tabla.num_estados; ++i) {
+        cout << i << "\t";
+        for (int t = 0; t < tabla.num_terminales; ++t) {
+            cout << accion_texto(tabla.accion(i, t)) << "\t";
+        }
+        for (int nt = 0; nt < tabla.num_no_terminales; ++nt) {
+            if (tabla.ir_a(i, nt) >= 0) cout << tabla.ir_a(i, nt) << "\t";
+            else cout << "\t";
+        }
+        cout << endl;
+    }
+}
+
+// Tabla LR(1) perezosa (--perezosa): solo existe al principio el estado 0, y cada celda de
+// ACTION/GOTO se calcula la primera vez que el analisis la consulta. Los estados nuevos
+// se numeran en el orden en que se alcanzan, no en el de construir_automata. La cache
+// vive en miembros mutable para poder usarla con analizar(), que recibe la tabla const.
+class TablaPerezosa {
+public:
+    int num_terminales;
+    int fin;
+    vector<int32_t> prod_izq;
+    vector<int32_t> prod_len;
+
+    TablaPerezosa(const Gramatica& g, const AnalisisGramatica& analisis) : g(g), analisis(analisis) {
+        num_terminales = g.simbolos.num_terminales;
+        fin = g.fin;
+        for (const auto& prod : g.producciones) {
+            prod_izq.push_back(prod.left - num_terminales);
+            prod_len.push_back(prod.right.size());
+        }
+        ConjuntoTerminales solo_fin(num_terminales);
+        solo_fin.insertar(fin);
+        obtener_estado({{0, 0, solo_fin}});
+    }
+
+    size_t num_estados() const {
+        return estados.size();
+    }
+
+    // Misma resolucion de conflictos que construir_tabla: la ultima reduccion con t en
+    // su lookahead gana sobre el shift.
+    uint32_t accion(int estado, int t) const {
+        uint32_t celda = estados[estado].acciones[t];
+        estadisticas.registrar_celda(celda == PENDIENTE);
+        if (celda != PENDIENTE) {
+            return celda;
+        }
+        celda = 0;
+        for (const auto& it : estados[estado].items) {
+            if (it.dot_pos == g.producciones[it.idx].right.size() && it.lookahead.contiene(t)) {
+                celda = (it.idx == 0 && t == fin) ? empaquetar(TipoAccion::ACCEPT, 0) : empaquetar(TipoAccion::REDUCE, it.idx);
+            }
+        }
+        if (celda == 0) {
+            int destino = transicion(estado, t);
+            if (destino >= 0) {
+                celda = empaquetar(TipoAccion::SHIFT, destino);
+            }
+        }
+        estados[estado].acciones[t] = celda;
+        return celda;
+    }
+
+    int32_t ir_a(int estado, int no_terminal) const {
+        int32_t destino = estados[estado].gotos[no_terminal];
+        estadisticas.registrar_celda(destino == GOTO_PENDIENTE);
+        if (destino == GOTO_PENDIENTE) {
+            destino = transicion(estado, no_terminal + num_terminales);
+            estados[estado].gotos[no_terminal] = destino;
+        }
+        return destino;
+    }
+
+    // Vuelca los nucleos construidos, en orden de id, para precargarlos en otra ejecucion.
+    // Formato de texto: cabecera con el hash de la gramatica y luego un estado por linea
+    // con sus items como "produccion punto n t1 ... tn".
+    bool volcar(const string& ruta, uint64_t hash) const {
+        ofstream out(ruta);
+        if (!out.is_open()) {
+            cerr << "Error: no se pudo escribir '" << ruta << "'." << endl;
+            return false;
+        }
+        out << "LR1PEREZOSA " << hash << "\n" << estados.size() << "\n";
+        for (const auto& estado : estados) {
+            out << estado.nucleo.size();
+            for (const auto& it : estado.nucleo) {
+                out << " " << it.idx << " " << it.dot_pos << " " << it.lookahead.tamano();
+                it.lookahead.para_cada([&](int t) { out << " " << t; });
+            }
+            out << "\n";
+        }
+        return bool(out);
+    }
+
+    // Recrea los estados de un volcado con sus mismos ids; las celdas se siguen calculando
+    // bajo demanda.
+    bool precargar(const string& ruta, uint64_t hash, string& error) {
+        ifstream in(ruta);
+        string magia;
+        uint64_t hash_archivo;
+        size_t n;
+        if (!(in >> magia >> hash_archivo >> n) || magia != "LR1PEREZOSA") {
+            error = "'" + ruta + "' no es un volcado de estados";
+            return false;
+        }
+        if (hash_archivo != hash) {
+            error = "el volcado '" + ruta + "' no corresponde a la gramatica";
+            return false;
+        }
+        for (size_t s = 0; s < n; ++s) {
+            size_t num_items;
+            if (!(in >> num_items) || num_items == 0) {
+                error = "volcado truncado";
+                return false;
+            }
+            ConjuntoItems nucleo;
+            for (size_t k = 0; k < num_items; ++k) {
+                int idx, dot_pos;
+                size_t num_la;
+                if (!(in >> idx >> dot_pos >> num_la) || idx < 0 || idx >= int(g.producciones.size())
+                    || dot_pos < 0 || dot_pos > int(g.producciones[idx].right.size())) {
+                    error = "item invalido en el estado " + to_string(s);
+                    return false;
+                }
+                ConjuntoTerminales la(num_terminales);
+                for (size_t j = 0; j < num_la; ++j) {
+                    int t;
+                    if (!(in >> t) || t < 0 || t >= num_terminales) {
+                        error = "lookahead invalido en el estado " + to_string(s);
+                        return false;
+                    }
+                    la.insertar(t);
+                }
+                nucleo.push_back({idx, dot_pos, la});
+            }
+            sort(nucleo.begin(), nucleo.end(), menor_nucleo);
+            if (obtener_estado(move(nucleo)) != int(s)) {
+                error = "el estado " + to_string(s) + " del volcado esta repetido o no coincide";
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t PENDIENTE = 0xFFFFFFFF;
+    static constexpr int32_t GOTO_PENDIENTE = -2;
+
+    struct EstadoPerezoso {
+        ConjuntoItems nucleo;
+        ConjuntoItems items;
+        vector<uint32_t> acciones;
+        vector<int32_t> gotos;
+    };
+
+    const Gramatica& g;
+    const AnalisisGramatica& analisis;
+    mutable vector<EstadoPerezoso> estados;
+    mutable unordered_map<ConjuntoItems, int, HashItems> estado_id;
+
+    int obtener_estado(ConjuntoItems&& nucleo) const {
+        auto it = estado_id.find(nucleo);
+        estadisticas.registrar_busqueda(it != estado_id.end());
+        if (it != estado_id.end()) {
+            return it->second;
+        }
+        int nuevo_id = estados.size();
+        ConjuntoItems items = closure(nucleo, g, analisis);
+        estados.push_back({nucleo, move(items), vector<uint32_t>(num_terminales, PENDIENTE),
+                           vector<int32_t>(g.simbolos.size() - num_terminales, GOTO_PENDIENTE)});
+        estado_id.emplace(move(nucleo), nuevo_id);
+        return nuevo_id;
+    }
+
+    int transicion(int estado, int X) const {
+        ConjuntoItems nucleo = nucleo_goto(estados[estado].items, X, g);
+        return nucleo.empty() ? -1 : obtener_estado(move(nucleo));
+    }
+};
+
+struct ResultadoParse {
+    bool aceptada;
+    int estado;      // estado en el que se detuvo el analisis
+    int simbolo;     // terminal o no terminal que no tuvo accion/goto
+    bool sin_goto;
+    size_t pos;      // tokens consumidos
+};
+
+// Bucle LR sobre ids de terminales. La pila de estados la provee quien llama para
+// reutilizarla entre cadenas; no se usa pila de simbolos porque el estado ya lo determina.
+template <typename Tabla>
+ResultadoParse analizar(const Tabla& tabla, const int* tokens, size_t n, vector<int>& pila) {
+    pila.clear();
+    pila.push_back(0);
+    size_t pos = 0;
+    int word = (pos < n) ? tokens[pos] : tabla.fin;
+
+    while (true) {
+        int state = pila.back();
+        uint32_t act = tabla.accion(state, word);
+        switch (tipo_accion(act)) {
+            case TipoAccion::SHIFT:
+                pila.push_back(destino_accion(act));
+                ++pos;
+                word = (pos < n) ? tokens[pos] : tabla.fin;
+                break;
+            case TipoAccion::REDUCE: {
+                uint32_t prod = destino_accion(act);
+                // Solo una tabla inconsistente (p. ej. un .lrt danado) reduce mas de lo apilado.
+                if (size_t(tabla.prod_len[prod]) >= pila.size()) {
+                    return {false, state, word, false, pos};
+                }
+                pila.resize(pila.size() - tabla.prod_len[prod]);
+                int next_state = tabla.ir_a(pila.back(), tabla.prod_izq[prod]);
+                if (next_state < 0) {
+                    return {false, pila.back(), tabla.prod_izq[prod], true, pos};
+                }
+                pila.push_back(next_state);
+                break;
+            }
+            case TipoAccion::ACCEPT:
+                return {true, state, word, false, pos};
+            default:
+                return {false, state, word, false, pos};
+        }
+    }
+}
+
+void informar_resultado(const ResultadoParse& r, const TablaSimbolos& simbolos) {
+    if (r.aceptada) {
+        cout << "Cadena aceptada." << endl;
+    } else if (r.sin_goto) {
+        cout << "Cadena rechazada (no hay goto para estado " << r.estado << " y símbolo '" << simbolos.nombre(r.simbolo + simbolos.num_terminales) << "')." << endl;
+    } else {
+        cout << "Cadena rechazada (no hay acción para estado " << r.estado << " y símbolo '" << simbolos.nombre(r.simbolo) << "')." << endl;
+    }
+}
+
+template <typename Tabla>
+bool parse_string(const vector<int>& input, const TablaSimbolos& simbolos, const Tabla& tabla) {
+    vector<int> pila;
+    pila.reserve(input.size() + 1);
+    ResultadoParse r = analizar(tabla, input.data(), input.size(), pila);
+    informar_resultado(r, simbolos);
+    return r.aceptada;
+}
+
+// Arena de bloques: reservar() solo avanza un puntero y todo se libera junto en liberar()
+// o al destruir la arena. No se llaman destructores, asi que solo sirve para tipos triviales.
+class Arena {
+public:
+    explicit Arena(size_t tamano_bloque = 64 * 1024) : tamano_bloque(tamano_bloque) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* reservar(size_t bytes, size_t alineacion) {
+        size_t ajuste = (alineacion - uintptr_t(actual) % alineacion) % alineacion;
+        if (actual == nullptr || ajuste + bytes > libre) {
+            size_t tamano = max(tamano_bloque, bytes + alineacion);
+            bloques.emplace_back(new char[tamano]);
+            actual = bloques.back().get();
+            libre = tamano;
+            reservados += tamano;
+            ajuste = (alineacion - uintptr_t(actual) % alineacion) % alineacion;
+        }
+        char* p = actual + ajuste;
+        actual = p + bytes;
+        libre -= ajuste + bytes;
+        return p;
+    }
+
+    template <typename T>
+    T* crear_arreglo(size_t n) {
+        return static_cast<T*>(reservar(n * sizeof(T), alignof(T)));
+    }
+
+    void liberar() {
+        bloques.clear();
+        actual = nullptr;
+        libre = 0;
+        reservados = 0;
+    }
+
+    size_t bytes_reservados() const {
+        return reservados;
+    }
+
+private:
+    size_t tamano_bloque;
+    vector<unique_ptr<char[]>> bloques;
+    char* actual = nullptr;
+    size_t libre = 0;
+    size_t reservados = 0;
+};
+
+// Nodo del arbol de derivacion. Los hijos son un arreglo contiguo dentro de la arena y
+// la posicion en la fuente es el rango de tokens que cubre el nodo.
+struct NodoArbol {
+    int32_t simbolo;
+    uint32_t num_hijos;
+    NodoArbol** hijos;
+    uint32_t primer_token;
+    uint32_t num_tokens;
+};
+
+// Arma el arbol a medida que el parser desplaza y reduce. Si conservar no esta vacio,
+// solo se crean nodos para los simbolos marcados y los hijos de un simbolo descartado
+// suben a su padre. nodos guarda los nodos pendientes de todas las entradas de la pila y
+// cada entrada recuerda donde empiezan los suyos.
+class ConstructorArbol {
+public:
+    ConstructorArbol(Arena& arena, int simbolo_inicial, const vector<char>& conservar)
+        : arena(arena), simbolo_inicial(simbolo_inicial), conservar(conservar) {
+        reiniciar();
+    }
+
+    void reiniciar() {
+        nodos.clear();
+        pila.clear();
+        pila.push_back({0, 0});
+        num_creados = 0;
+    }
+
+    void desplazar(int terminal, uint32_t pos) {
+        pila.push_back({uint32_t(nodos.size()), pos});
+        if (se_conserva(terminal)) {
+            nodos.push_back(crear(terminal, nodos.size(), pos, 1));
+        }
+    }
+
+    // simbolo es el id absoluto del lado izquierdo; pos, los tokens consumidos hasta ahora.
+    void reducir(int simbolo, int len, uint32_t pos) {
+        uint32_t inicio = len > 0 ? pila[pila.size() - len].inicio_nodos : nodos.size();
+        uint32_t primer = len > 0 ? pila[pila.size() - len].primer_token : pos;
+        pila.resize(pila.size() - len);
+        pila.push_back({inicio, primer});
+        if (se_conserva(simbolo)) {
+            NodoArbol* nodo = crear(simbolo, inicio, primer, pos - primer);
+            nodos.resize(inicio);
+            nodos.push_back(nodo);
+        }
+    }
+
+    // Al aceptar, lo que quede pendiente cuelga de un nodo para el simbolo inicial.
+    NodoArbol* raiz(uint32_t num_tokens) {
+        return crear(simbolo_inicial, 0, 0, num_tokens);
+    }
+
+    size_t nodos_creados() const {
+        return num_creados;
+    }
+
+private:
+    struct Entrada {
+        uint32_t inicio_nodos;
+        uint32_t primer_token;
+    };
+
+    Arena& arena;
+    int simbolo_inicial;
+    const vector<char>& conservar;
+    vector<NodoArbol*> nodos;
+    vector<Entrada> pila;
+    size_t num_creados = 0;
+
+    bool se_conserva(int simbolo) const {
+        return conservar.empty() || conservar[simbolo];
+    }
+
+    NodoArbol* crear(int simbolo, uint32_t inicio_hijos, uint32_t primer, uint32_t num_tokens) {
+        NodoArbol* nodo = arena.crear_arreglo<NodoArbol>(1);
+        uint32_t num_hijos = nodos.size() - inicio_hijos;
+        nodo->simbolo = simbolo;
+        nodo->num_hijos = num_hijos;
+        nodo->hijos = num_hijos ? arena.crear_arreglo<NodoArbol*>(num_hijos) : nullptr;
+        copy(nodos.begin() + inicio_hijos, nodos.end(), nodo->hijos);
+        nodo->primer_token = primer;
+        nodo->num_tokens = num_tokens;
+        ++num_creados;
+        return nodo;
+    }
+};
+
+struct OpcionesArbol {
+    bool activo = false;
+    vector<char> conservar;  // por id de simbolo; vacio conserva todos
+};
+
+// Marca los simbolos de una lista separada por comas (--arbol-solo a,b).
+bool elegir_simbolos_arbol(const string& lista, const TablaSimbolos& simbolos, OpcionesArbol& arbol) {
+    arbol.conservar.assign(simbolos.size(), 0);
+    stringstream ss(lista);
+    string nombre;
+    while (getline(ss, nombre, ',')) {
+        int id = simbolos.id(nombre);
+        if (id < 0) {
+            cerr << "Error: simbolo desconocido '" << nombre << "' en --arbol-solo." << endl;
+            return false;
+        }
+        arbol.conservar[id] = 1;
+    }
+    return true;
+}
+
+// Arena y constructor de un analisis con --arbol; al destruirse se libera el arbol entero.
+struct SesionArbol {
+    Arena arena;
+    ConstructorArbol constructor;
+
+    template <typename Tabla>
+    SesionArbol(const Tabla& tabla, const vector<char>& conservar)
+        : constructor(arena, tabla.prod_izq[0] + tabla.num_terminales, conservar) {}
+};
+
+// posiciones, si se da, tiene (linea, columna) por token. Las listas recursivas por la
+// izquierda dan arboles tan profundos como la cantidad de sentencias, asi que el recorrido
+// usa una pila explicita y la sangria se corta en MAX_SANGRIA niveles; mas abajo cada
+// linea empieza con su profundidad entre corchetes.
+void imprimir_arbol(const NodoArbol* raiz, const TablaSimbolos& simbolos, const vector<pair<int, int>>* posiciones) {
+    const int MAX_SANGRIA = 32;
+    vector<pair<const NodoArbol*, int>> pendientes = {{raiz, 0}};
+    while (!pendientes.empty()) {
+        auto [nodo, profundidad] = pendientes.back();
+        pendientes.pop_back();
+        cout << string(2 * min(profundidad, MAX_SANGRIA), ' ');
+        if (profundidad > MAX_SANGRIA) {
+            cout << "[" << profundidad << "] ";
+        }
+        cout << simbolos.nombre(nodo->simbolo) << " [" << nodo->primer_token << ", " << nodo->primer_token + nodo->num_tokens << ")";
+        if (posiciones && nodo->num_tokens > 0) {
+            const auto& [linea, columna] = (*posiciones)[nodo->primer_token];
+            cout << " " << linea << ":" << columna;
+        }
+        cout << '\n';
+        for (uint32_t i = nodo->num_hijos; i-- > 0;) {
+            pendientes.push_back({nodo->hijos[i], profundidad + 1});
+        }
+    }
+}
+
+void informar_arbol(SesionArbol& sesion, uint32_t num_tokens, const TablaSimbolos& simbolos, const vector<pair<int, int>>* posiciones) {
+    imprimir_arbol(sesion.constructor.raiz(num_tokens), simbolos, posiciones);
+    cout << "Nodos: " << sesion.constructor.nodos_creados() << ", arena: " << sesion.arena.bytes_reservados() << " bytes" << endl;
+}
+
+// Parser por empuje: recibe los terminales de a uno con alimentar() y el fin de la
+// entrada con terminar(), conservando la pila de estados entre llamadas. Cada objeto es
+// independiente, asi que pueden analizarse varios flujos a la vez con la misma tabla.
+template <typename Tabla>
+class ParserEmpuje {
+public:
+    explicit ParserEmpuje(const Tabla& tabla) : tabla(tabla) {
+        reiniciar();
+    }
+
+    void reiniciar() {
+        pila.clear();
+        pila.push_back(0);
+        resultado = {false, 0, 0, false, 0};
+        terminado = false;
+        if (arbol) {
+            arbol->reiniciar();
+        }
+    }
+
+    // Con un constructor, cada shift y cada reduccion tambien actualizan el arbol.
+    void construir_arbol(ConstructorArbol* constructor) {
+        arbol = constructor;
+        if (arbol) {
+            arbol->reiniciar();
+        }
+    }
+
+    // Reduce lo necesario y desplaza el terminal. Devuelve false si la entrada ya no
+    // puede ser valida; a partir de ahi las llamadas no hacen nada.
+    bool alimentar(int terminal) {
+        if (terminado) {
+            return false;
+        }
+        uint32_t act = reducir_hasta_accion(terminal);
+        if (terminado) {
+            return false;
+        }
+        if (tipo_accion(act) == TipoAccion::SHIFT) {
+            pila.push_back(destino_accion(act));
+            if (arbol) {
+                arbol->desplazar(terminal, resultado.pos);
+            }
+            ++resultado.pos;
+            return true;
+        }
+        detener(act, terminal);
+        return false;
+    }
+
+    const ResultadoParse& terminar() {
+        if (!terminado) {
+            detener(reducir_hasta_accion(tabla.fin), tabla.fin);
+        }
+        return resultado;
+    }
+
+    bool fallo() const {
+        return terminado && !resultado.aceptada;
+    }
+
+private:
+    const Tabla& tabla;
+    vector<int> pila;
+    ResultadoParse resultado;
+    bool terminado;
+    ConstructorArbol* arbol = nullptr;
+
+    uint32_t reducir_hasta_accion(int word) {
+        while (true) {
+            uint32_t act = tabla.accion(pila.back(), word);
+            if (tipo_accion(act) != TipoAccion::REDUCE) {
+                return act;
+            }
+            uint32_t prod = destino_accion(act);
+            if (size_t(tabla.prod_len[prod]) >= pila.size()) {
+                return 0;
+            }
+            pila.resize(pila.size() - tabla.prod_len[prod]);
+            int next_state = tabla.ir_a(pila.back(), tabla.prod_izq[prod]);
+            if (next_state < 0) {
+                resultado = {false, pila.back(), tabla.prod_izq[prod], true, resultado.pos};
+                terminado = true;
+                return 0;
+            }
+            pila.push_back(next_state);
+            if (arbol) {
+                arbol->reducir(tabla.prod_izq[prod] + tabla.num_terminales, tabla.prod_len[prod], resultado.pos);
+            }
+        }
+    }
+
+    void detener(uint32_t act, int word) {
+        if (!terminado) {
+            resultado = {tipo_accion(act) == TipoAccion::ACCEPT, pila.back(), word, false, resultado.pos};
+            terminado = true;
+        }
+    }
+};
+
+// Analiza los terminales de in a medida que se leen (--flujo), sin guardar la entrada.
+template <typename Tabla>
+bool parse_flujo(istream& in, const TablaSimbolos& simbolos, const Tabla& tabla, const OpcionesArbol& arbol) {
+    ParserEmpuje<Tabla> parser(tabla);
+    unique_ptr<SesionArbol> sesion;
+    if (arbol.activo) {
+        sesion.reset(new SesionArbol(tabla, arbol.conservar));
+        parser.construir_arbol(&sesion->constructor);
+    }
+    string tok;
+    while (in >> tok) {
+        int id = simbolos.id(tok);
+        if (id < 0 || !simbolos.es_terminal(id)) {
+            cout << "Cadena rechazada (símbolo desconocido '" << tok << "')." << endl;
+            return false;
+        }
+        if (!parser.alimentar(id)) {
+            break;
+        }
+    }
+    const ResultadoParse& r = parser.terminar();
+    informar_resultado(r, simbolos);
+    if (sesion && r.aceptada) {
+        informar_arbol(*sesion, r.pos, simbolos, nullptr);
+    }
+    return r.aceptada;
+}
+
+// Archivo binario de tablas (.lrt). Todo va en el orden de bytes de la maquina y cada
+// seccion queda alineada a 8 bytes, de modo que al mapear el archivo las tablas se usan
+// en su lugar sin copiarlas.
+const char MAGIA_TABLA[8] = {'L', 'R', '1', 'T', 'A', 'B', 'L', 'A'};
+const uint32_t VERSION_TABLA = 1;
+
+enum SeccionTabla {
+    SEC_NOMBRES_INICIO,   // uint32 por simbolo + 1, desplazamientos en SEC_NOMBRES_TEXTO
+    SEC_NOMBRES_TEXTO,
+    SEC_PROD_IZQ,
+    SEC_PROD_LEN,
+    SEC_PROD_DERECHA,     // lados derechos concatenados, ids de simbolo
+    SEC_FILA_ACCION,
+    SEC_ACCION_DEFECTO,
+    SEC_ACCION_BASE,
+    SEC_ACCION_CHECK,
+    SEC_ACCION_VALOR,
+    SEC_GOTO_DEFECTO,
+    SEC_GOTO_BASE,
+    SEC_GOTO_CHECK,
+    SEC_GOTO_VALOR,
+    NUM_SECCIONES
+};
+
+struct Seccion {
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+struct CabeceraTabla {
+    char magia[8];
+    uint32_t version;
+    uint32_t num_estados;
+    uint32_t num_terminales;
+    uint32_t num_no_terminales;
+    uint32_t num_producciones;
+    uint32_t fin;
+    uint64_t hash_gramatica;
+    uint64_t tamano;
+    Seccion secciones[NUM_SECCIONES];
+};
+
+// FNV-1a de 64 bits sobre el texto de la gramatica.
+uint64_t hash_gramatica(const string& archivo) {
+    ifstream in(archivo, ios::binary);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    char c;
+    while (in.get(c)) {
+        h = (h ^ uint8_t(c)) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+bool escribir_tabla_binaria(const string& ruta, const Gramatica& g, const TablaComprimida& tabla, uint64_t hash) {
+    vector<char> datos(sizeof(CabeceraTabla), 0);
+    CabeceraTabla cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, MAGIA_TABLA, sizeof(cab.magia));
+    cab.version = VERSION_TABLA;
+    cab.num_estados = tabla.num_estados;
+    cab.num_terminales = tabla.num_terminales;
+    cab.num_no_terminales = tabla.num_no_terminales;
+    cab.num_producciones = g.producciones.size();
+    cab.fin = tabla.fin;
+    cab.hash_gramatica = hash;
+
+    auto agregar = [&](SeccionTabla sec, const void* p, size_t bytes) {
+        datos.resize((datos.size() + 7) & ~size_t(7), 0);
+        cab.secciones[sec] = {datos.size(), bytes};
+        datos.insert(datos.end(), (const char*)p, (const char*)p + bytes);
+    };
+    auto agregar_vector = [&](SeccionTabla sec, const auto& v) {
+        agregar(sec, v.data(), v.size() * sizeof(v[0]));
+    };
+
+    vector<uint32_t> nombres_inicio;
+    string nombres_texto;
+    for (int id = 0; id < g.simbolos.size(); ++id) {
+        nombres_inicio.push_back(nombres_texto.size());
+        nombres_texto += g.simbolos.nombre(id);
+    }
+    nombres_inicio.push_back(nombres_texto.size());
+    vector<int32_t> derecha;
+    for (const auto& prod : g.producciones) {
+        derecha.insert(derecha.end(), prod.right.begin(), prod.right.end());
+    }
+
+    agregar_vector(SEC_NOMBRES_INICIO, nombres_inicio);
+    agregar(SEC_NOMBRES_TEXTO, nombres_texto.data(), nombres_texto.size());
+    agregar_vector(SEC_PROD_IZQ, tabla.prod_izq);
+    agregar_vector(SEC_PROD_LEN, tabla.prod_len);
+    agregar_vector(SEC_PROD_DERECHA, derecha);
+    agregar_vector(SEC_FILA_ACCION, tabla.fila_accion);
+    agregar_vector(SEC_ACCION_DEFECTO, tabla.accion_defecto);
+    agregar_vector(SEC_ACCION_BASE, tabla.peine_accion.base);
+    agregar_vector(SEC_ACCION_CHECK, tabla.peine_accion.check);
+    agregar_vector(SEC_ACCION_VALOR, tabla.peine_accion.valor);
+    agregar_vector(SEC_GOTO_DEFECTO, tabla.goto_defecto);
+    agregar_vector(SEC_GOTO_BASE, tabla.peine_goto.base);
+    agregar_vector(SEC_GOTO_CHECK, tabla.peine_goto.check);
+    agregar_vector(SEC_GOTO_VALOR, tabla.peine_goto.valor);
+    cab.tamano = datos.size();
+    memcpy(datos.data(), &cab, sizeof(cab));
+
+    ofstream out(ruta, ios::binary);
+    if (!out.write(datos.data(), datos.size())) {
+        cerr << "Error: no se pudo escribir el archivo de tablas '" << ruta << "'." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Archivo de tablas mapeado con mmap. tabla apunta directamente a las paginas mapeadas;
+// solo la tabla de simbolos se reconstruye para traducir la entrada.
+class ArchivoTabla {
+public:
+    VistaComprimida tabla;
+    TablaSimbolos simbolos;
+    const int32_t* prod_derecha = nullptr;
+
+    ArchivoTabla() = default;
+    ArchivoTabla(const ArchivoTabla&) = delete;
+    ArchivoTabla& operator=(const ArchivoTabla&) = delete;
+
+    ~ArchivoTabla() {
+        if (datos) {
+            munmap(const_cast<char*>(datos), tamano);
+        }
+    }
+
+    const CabeceraTabla& cabecera() const {
+        return *reinterpret_cast<const CabeceraTabla*>(datos);
+    }
+
+    bool abrir(const string& ruta, string& error) {
+        int fd = open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "no se puede abrir '" + ruta + "'";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(CabeceraTabla)) {
+            close(fd);
+            error = "archivo de tablas truncado";
+            return false;
+        }
+        tamano = st.st_size;
+        void* p = mmap(nullptr, tamano, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            error = "mmap fallo";
+            return false;
+        }
+        datos = static_cast<const char*>(p);
+
+        const CabeceraTabla& cab = cabecera();
+        if (memcmp(cab.magia, MAGIA_TABLA, sizeof(cab.magia)) != 0) {
+            error = "no es un archivo de tablas";
+            return false;
+        }
+        if (cab.version != VERSION_TABLA) {
+            error = "version de tablas " + to_string(cab.version) + " no soportada";
+            return false;
+        }
+        if (cab.tamano != tamano) {
+            error = "tamano de archivo inconsistente";
+            return false;
+        }
+        for (int sec = 0; sec < NUM_SECCIONES; ++sec) {
+            const Seccion& s = cab.secciones[sec];
+            if (s.offset % 8 != 0 || s.offset > tamano || s.bytes > tamano - s.offset) {
+                error = "seccion " + to_string(sec) + " fuera del archivo";
+                return false;
+            }
+        }
+        size_t num_simbolos = cab.num_terminales + cab.num_no_terminales;
+        if (cantidad<uint32_t>(SEC_NOMBRES_INICIO) != num_simbolos + 1
+            || cantidad<int32_t>(SEC_PROD_IZQ) != cab.num_producciones
+            || cantidad<int32_t>(SEC_PROD_LEN) != cab.num_producciones
+            || cantidad<int32_t>(SEC_FILA_ACCION) != cab.num_estados
+            || cantidad<uint32_t>(SEC_ACCION_DEFECTO) != cab.num_estados
+            || cantidad<int32_t>(SEC_GOTO_DEFECTO) != cab.num_no_terminales
+            || cantidad<int32_t>(SEC_GOTO_BASE) != cab.num_no_terminales
+            || cantidad<int32_t>(SEC_ACCION_CHECK) != cantidad<uint32_t>(SEC_ACCION_VALOR)
+            || cantidad<int32_t>(SEC_GOTO_CHECK) != cantidad<uint32_t>(SEC_GOTO_VALOR)) {
+            error = "secciones de tamano inconsistente";
+            return false;
+        }
+
+        if (!validar_tablas(error)) {
+            return false;
+        }
+
+        const uint32_t* inicio = seccion<uint32_t>(SEC_NOMBRES_INICIO);
+        const char* texto = seccion<char>(SEC_NOMBRES_TEXTO);
+        for (size_t id = 0; id < num_simbolos; ++id) {
+            // Un nombre repetido devolveria el id anterior y dejaria la tabla de nombres corta.
+            if (inicio[id] > inicio[id + 1] || inicio[id + 1] > cab.secciones[SEC_NOMBRES_TEXTO].bytes
+                || simbolos.agregar(string(texto + inicio[id], inicio[id + 1] - inicio[id])) != int(id)) {
+                error = "nombres de simbolos corruptos";
+                return false;
+            }
+        }
+        simbolos.num_terminales = cab.num_terminales;
+
+        tabla.num_estados = cab.num_estados;
+        tabla.num_terminales = cab.num_terminales;
+        tabla.num_no_terminales = cab.num_no_terminales;
+        tabla.fin = cab.fin;
+        tabla.fila_accion = seccion<int32_t>(SEC_FILA_ACCION);
+        tabla.accion_defecto = seccion<uint32_t>(SEC_ACCION_DEFECTO);
+        tabla.peine_accion = {seccion<int32_t>(SEC_ACCION_BASE), seccion<int32_t>(SEC_ACCION_CHECK),
+                              seccion<uint32_t>(SEC_ACCION_VALOR), cantidad<int32_t>(SEC_ACCION_CHECK)};
+        tabla.goto_defecto = seccion<int32_t>(SEC_GOTO_DEFECTO);
+        tabla.peine_goto = {seccion<int32_t>(SEC_GOTO_BASE), seccion<int32_t>(SEC_GOTO_CHECK),
+                            seccion<uint32_t>(SEC_GOTO_VALOR), cantidad<int32_t>(SEC_GOTO_CHECK)};
+        tabla.prod_izq = seccion<int32_t>(SEC_PROD_IZQ);
+        tabla.prod_len = seccion<int32_t>(SEC_PROD_LEN);
+        prod_derecha = seccion<int32_t>(SEC_PROD_DERECHA);
+        return true;
+    }
+
+private:
+    const char* datos = nullptr;
+    size_t tamano = 0;
+
+    // Comprueba que todo indice que el parser toma de las tablas caiga dentro de ellas:
+    // filas y bases de los peines, destinos de SHIFT, REDUCE y GOTO, y las producciones.
+    bool validar_tablas(string& error) const {
+        const CabeceraTabla& cab = cabecera();
+        auto fallar = [&](const string& que) {
+            error = "tablas corruptas (" + que + ")";
+            return false;
+        };
+        if (cab.num_estados == 0 || cab.num_terminales == 0 || cab.num_no_terminales == 0 || cab.num_producciones == 0
+            || cab.num_estados >= (1u << 30) || cab.num_producciones >= (1u << 30)) {
+            return fallar("cabecera");
+        }
+        if (cab.fin >= cab.num_terminales) {
+            return fallar("fin");
+        }
+        size_t num_simbolos = cab.num_terminales + cab.num_no_terminales;
+
+        const int32_t* izq = seccion<int32_t>(SEC_PROD_IZQ);
+        const int32_t* len = seccion<int32_t>(SEC_PROD_LEN);
+        size_t total_derecha = 0;
+        for (uint32_t p = 0; p < cab.num_producciones; ++p) {
+            if (izq[p] < 0 || uint32_t(izq[p]) >= cab.num_no_terminales || len[p] < 0) {
+                return fallar("produccion " + to_string(p));
+            }
+            total_derecha += len[p];
+        }
+        if (cantidad<int32_t>(SEC_PROD_DERECHA) != total_derecha) {
+            return fallar("lados derechos");
+        }
+        const int32_t* derecha = seccion<int32_t>(SEC_PROD_DERECHA);
+        for (size_t i = 0; i < total_derecha; ++i) {
+            if (derecha[i] < 0 || size_t(derecha[i]) >= num_simbolos) {
+                return fallar("lados derechos");
+            }
+        }
+
+        auto accion_valida = [&](uint32_t act) {
+            switch (tipo_accion(act)) {
+                case TipoAccion::SHIFT: return destino_accion(act) < cab.num_estados;
+                case TipoAccion::REDUCE: return destino_accion(act) < cab.num_producciones;
+                default: return true;
+            }
+        };
+        // base + columna se calcula en int: las bases fuera de este rango desbordarian.
+        auto bases_validas = [](const int32_t* base, size_t filas, int64_t columnas, size_t tamano_peine) {
+            for (size_t f = 0; f < filas; ++f) {
+                if (base[f] < -columnas || base[f] > int64_t(tamano_peine)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        size_t filas_accion = cantidad<int32_t>(SEC_ACCION_BASE);
+        const int32_t* fila = seccion<int32_t>(SEC_FILA_ACCION);
+        const uint32_t* defecto = seccion<uint32_t>(SEC_ACCION_DEFECTO);
+        for (uint32_t e = 0; e < cab.num_estados; ++e) {
+            if (fila[e] < 0 || size_t(fila[e]) >= filas_accion || !accion_valida(defecto[e])) {
+                return fallar("fila de ACTION del estado " + to_string(e));
+            }
+        }
+        size_t tamano_accion = cantidad<int32_t>(SEC_ACCION_CHECK);
+        if (!bases_validas(seccion<int32_t>(SEC_ACCION_BASE), filas_accion, cab.num_terminales, tamano_accion)) {
+            return fallar("bases de ACTION");
+        }
+        const uint32_t* valor_accion = seccion<uint32_t>(SEC_ACCION_VALOR);
+        for (size_t i = 0; i < tamano_accion; ++i) {
+            if (!accion_valida(valor_accion[i])) {
+                return fallar("accion " + to_string(i));
+            }
+        }
+
+        const int32_t* goto_defecto = seccion<int32_t>(SEC_GOTO_DEFECTO);
+        for (uint32_t A = 0; A < cab.num_no_terminales; ++A) {
+            if (goto_defecto[A] < -1 || goto_defecto[A] >= int64_t(cab.num_estados)) {
+                return fallar("GOTO por defecto de " + to_string(A));
+            }
+        }
+        size_t tamano_goto = cantidad<int32_t>(SEC_GOTO_CHECK);
+        if (!bases_validas(seccion<int32_t>(SEC_GOTO_BASE), cab.num_no_terminales, cab.num_estados, tamano_goto)) {
+            return fallar("bases de GOTO");
+        }
+        const uint32_t* valor_goto = seccion<uint32_t>(SEC_GOTO_VALOR);
+        for (size_t i = 0; i < tamano_goto; ++i) {
+            if (valor_goto[i] >= cab.num_estados) {
+                return fallar("GOTO " + to_string(i));
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    const T* seccion(int sec) const {
+        return reinterpret_cast<const T*>(datos + cabecera().secciones[sec].offset);
+    }
+
+    template <typename T>
+    size_t cantidad(int sec) const {
+        return cabecera().secciones[sec].bytes / sizeof(T);
+    }
+};
+
+// Lee una cadena de terminales separados por espacios desde stdin.
+bool leer_cadena(const TablaSimbolos& simbolos, vector<int>& input) {
+    cout << "\nIngrese la cadena: ";
+    string input_line;
+    getline(cin, input_line);
+    stringstream ss(input_line);
+    string tok;
+    while (ss >> tok) {
+        int id = simbolos.id(tok);
+        if (id < 0 || !simbolos.es_terminal(id)) {
+            cout << "Cadena rechazada (símbolo desconocido '" << tok << "')." << endl;
+            return false;
+        }
+        input.push_back(id);
+    }
+    return true;
+}
+
+// Tabla para GLR: la tabla densa de siempre, pero cada celda con mas de una accion guarda
+// en su lugar un ERROR con destino k + 1, donde k indexa la lista completa de acciones en
+// conflictos. Las celdas sin conflicto se leen igual que en TablaLR.
+struct TablaGLR {
+    TablaLR base;
+    vector<vector<uint32_t>> conflictos;
+
+    const uint32_t* acciones(int estado, int terminal, uint32_t& unica, size_t& n) const {
+        unica = base.accion(estado, terminal);
+        if (tipo_accion(unica) == TipoAccion::ERROR && unica != 0) {
+            const auto& lista = conflictos[unica - 1];
+            n = lista.size();
+            return lista.data();
+        }
+        n = unica != 0;
+        return &unica;
+    }
+};
+
+// Mismo recorrido que construir_tabla pero juntando todas las acciones de cada celda:
+// primero el shift y despues las reducciones en orden de item, sin repetir.
+TablaGLR construir_tabla_glr(const Automata& automata, const Gramatica& g) {
+    TablaGLR tabla;
+    tabla.base = construir_tabla(automata, g);
+    int T = tabla.base.num_terminales;
+    vector<vector<uint32_t>> celda(T);
+    for (int idx = 0; idx < tabla.base.num_estados; ++idx) {
+        const Estado& estado = automata.estados[idx];
+        for (auto& c : celda) c.clear();
+        for (const auto& [X, to_id] : estado.transiciones) {
+            if (g.simbolos.es_terminal(X)) {
+                celda[X].push_back(empaquetar(TipoAccion::SHIFT, to_id));
+            }
+        }
+        for (const auto& it : estado.items) {
+            if (it.dot_pos == g.producciones[it.idx].right.size()) {
+                it.lookahead.para_cada([&](int t) {
+                    uint32_t a = (it.idx == 0 && t == g.fin) ? empaquetar(TipoAccion::ACCEPT, 0) : empaquetar(TipoAccion::REDUCE, it.idx);
+                    if (find(celda[t].begin(), celda[t].end(), a) == celda[t].end()) {
+                        celda[t].push_back(a);
+                    }
+                });
+            }
+        }
+        for (int t = 0; t < T; ++t) {
+            if (celda[t].size() > 1) {
+                tabla.conflictos.push_back(celda[t]);
+                tabla.base.acciones[size_t(idx) * T + t] = tabla.conflictos.size();
+            }
+        }
+    }
+    return tabla;
+}
+
+// Bosque de derivacion compartido y empaquetado: un NodoBosque por (simbolo, inicio, fin)
+// dentro de cada nivel del GSS, con una Alternativa por cada forma distinta de derivarlo.
+// Los terminales son hojas sin alternativas. Con gramaticas ciclicas el bosque puede
+// tener ciclos.
+struct Alternativa;
+
+struct NodoBosque {
+    int32_t simbolo;
+    uint32_t inicio;
+    uint32_t fin;
+    Alternativa* alternativas;
+};
+
+struct Alternativa {
+    int32_t produccion;
+    uint32_t num_hijos;
+    NodoBosque** hijos;
+    Alternativa* siguiente;
+};
+
+struct ResultadoGLR {
+    bool aceptada;
+    NodoBosque* raiz;
+    size_t pos;           // tokens consumidos
+    size_t tokens_glr;    // tokens que necesitaron el GSS
+};
+
+// Parser GLR al estilo de Tomita (con la correccion de Rekers para reducciones por
+// enlaces nuevos). Mientras no haya conflictos trabaja sobre una pila lineal con la
+// tabla empaquetada, igual que analizar(); solo cuando una celda tiene varias acciones o
+// una reduccion baja de la parte lineal, la pila pasa al GSS. Cuando el GSS vuelve a
+// tener una sola cima, esa cima pasa a ser la base de una nueva pila lineal.
+class ParserGLR {
+public:
+    ParserGLR(const TablaGLR& tabla) : tabla(tabla), base_tabla(tabla.base) {}
+
+    // El bosque se reserva en la arena de quien llama; el GSS se libera al terminar.
+    ResultadoGLR analizar(const int* tokens, size_t n, Arena& arena_bosque) {
+        bosque = &arena_bosque;
+        gss.liberar();
+        nivel_pos = UINT32_MAX;
+        size_t pos = 0;
+        size_t tokens_glr = 0;
+        NodoGSS* base = nuevo_nodo(0, 0);
+        lineal.clear();
+        lineal.push_back({0, nullptr, 0});
+
+        while (true) {
+            int word = (pos < n) ? tokens[pos] : base_tabla.fin;
+            // Camino deterministico.
+            uint32_t act = base_tabla.accion(lineal.back().estado, word);
+            TipoAccion tipo = tipo_accion(act);
+            if (tipo == TipoAccion::SHIFT) {
+                lineal.push_back({int(destino_accion(act)), hoja(word, pos), uint32_t(pos + 1)});
+                ++pos;
+                continue;
+            }
+            if (tipo == TipoAccion::REDUCE && size_t(base_tabla.prod_len[destino_accion(act)]) < lineal.size()) {
+                reducir_lineal(destino_accion(act), pos);
+                continue;
+            }
+            if (tipo == TipoAccion::ACCEPT && lineal.size() > 1) {
+                return {true, lineal.back().arbol, pos, tokens_glr};
+            }
+            if (act == 0) {
+                return {false, nullptr, pos, tokens_glr};
+            }
+
+            // Conflicto o reduccion que entra en el GSS: se procesa este token con GLR.
+            ++tokens_glr;
+            materializar(base, pos);
+            NodoBosque* raiz = nullptr;
+            procesar_nivel(word, pos, raiz);
+            if (raiz) {
+                return {true, raiz, pos, tokens_glr};
+            }
+            if (por_desplazar.empty()) {
+                return {false, nullptr, pos, tokens_glr};
+            }
+            desplazar(word, pos);
+            ++pos;
+            while (activos.size() > 1) {
+                word = (pos < n) ? tokens[pos] : base_tabla.fin;
+                ++tokens_glr;
+                por_actuar = activos;
+                procesar_nivel(word, pos, raiz);
+                if (raiz) {
+                    return {true, raiz, pos, tokens_glr};
+                }
+                if (por_desplazar.empty()) {
+                    return {false, nullptr, pos, tokens_glr};
+                }
+                desplazar(word, pos);
+                ++pos;
+            }
+            base = activos[0];
+            lineal.clear();
+            lineal.push_back({base->estado, nullptr, base->pos});
+        }
+    }
+
+private:
+    struct NodoGSS;
+
+    struct EnlaceGSS {
+        NodoGSS* destino;
+        NodoBosque* arbol;
+        EnlaceGSS* siguiente;
+    };
+
+    struct NodoGSS {
+        int estado;
+        uint32_t pos;
+        EnlaceGSS* enlaces;
+        bool procesado;
+    };
+
+    struct EntradaLineal {
+        int estado;
+        NodoBosque* arbol;
+        uint32_t pos;  // posicion en la entrada despues del simbolo
+    };
+
+    const TablaGLR& tabla;
+    const TablaLR& base_tabla;
+    Arena gss;
+    Arena* bosque = nullptr;
+    vector<EntradaLineal> lineal;
+    vector<NodoGSS*> activos, por_actuar;
+    vector<pair<NodoGSS*, int>> por_desplazar;
+    unordered_map<uint64_t, NodoBosque*> nodos_nivel;
+    uint32_t nivel_pos;
+    vector<NodoBosque*> hijos;
+
+    NodoGSS* nuevo_nodo(int estado, uint32_t pos) {
+        NodoGSS* nodo = gss.crear_arreglo<NodoGSS>(1);
+        *nodo = {estado, pos, nullptr, false};
+        return nodo;
+    }
+
+    EnlaceGSS* enlazar(NodoGSS* desde, NodoGSS* hacia, NodoBosque* arbol) {
+        EnlaceGSS* enlace = gss.crear_arreglo<EnlaceGSS>(1);
+        *enlace = {hacia, arbol, desde->enlaces};
+        desde->enlaces = enlace;
+        return enlace;
+    }
+
+    NodoBosque* hoja(int terminal, size_t pos) {
+        NodoBosque* nodo = bosque->crear_arreglo<NodoBosque>(1);
+        *nodo = {terminal, uint32_t(pos), uint32_t(pos + 1), nullptr};
+        return nodo;
+    }
+
+    void agregar_alternativa(NodoBosque* nodo, int prod, NodoBosque* const* kids, size_t len) {
+        for (Alternativa* a = nodo->alternativas; a; a = a->siguiente) {
+            if (a->produccion == prod && equal(kids, kids + len, a->hijos)) {
+                return;
+            }
+        }
+        Alternativa* a = bosque->crear_arreglo<Alternativa>(1);
+        a->produccion = prod;
+        a->num_hijos = len;
+        a->hijos = len ? bosque->crear_arreglo<NodoBosque*>(len) : nullptr;
+        copy(kids, kids + len, a->hijos);
+        a->siguiente = nodo->alternativas;
+        nodo->alternativas = a;
+    }
+
+    // Nodo del bosque para (simbolo, inicio) en el nivel actual, compartido entre caminos.
+    NodoBosque* nodo_simbolo(int simbolo, uint32_t inicio, uint32_t fin) {
+        preparar_nivel(fin);
+        NodoBosque*& nodo = nodos_nivel[uint64_t(simbolo) << 32 | inicio];
+        if (!nodo) {
+            nodo = bosque->crear_arreglo<NodoBosque>(1);
+            *nodo = {simbolo, inicio, fin, nullptr};
+        }
+        return nodo;
+    }
+
+    void preparar_nivel(uint32_t fin) {
+        if (nivel_pos != fin) {
+            nodos_nivel.clear();
+            nivel_pos = fin;
+        }
+    }
+
+    void reducir_lineal(int prod, size_t pos) {
+        int len = base_tabla.prod_len[prod];
+        int simbolo = base_tabla.prod_izq[prod] + base_tabla.num_terminales;
+        size_t tope = lineal.size() - len;
+        NodoBosque* nodo = bosque->crear_arreglo<NodoBosque>(1);
+        *nodo = {simbolo, lineal[tope - 1].pos, uint32_t(pos), nullptr};
+        hijos.clear();
+        for (size_t i = tope; i < lineal.size(); ++i) {
+            hijos.push_back(lineal[i].arbol);
+        }
+        agregar_alternativa(nodo, prod, hijos.data(), len);
+        lineal.resize(tope);
+        lineal.push_back({base_tabla.ir_a(lineal.back().estado, base_tabla.prod_izq[prod]), nodo, uint32_t(pos)});
+    }
+
+    // Pasa la pila lineal al GSS encima de base. Las entradas del nivel actual quedan
+    // activas y sus nodos del bosque se registran para compartirlos; solo la cima falta
+    // procesar, las demas ya ejecutaron su accion.
+    void materializar(NodoGSS* base, size_t pos) {
+        activos.clear();
+        por_actuar.clear();
+        preparar_nivel(pos);
+        for (size_t i = 1; i < lineal.size(); ++i) {
+            NodoBosque* arbol = lineal[i].arbol;
+            if (lineal[i].pos == pos && arbol->alternativas) {
+                nodos_nivel.emplace(uint64_t(arbol->simbolo) << 32 | arbol->inicio, arbol);
+            }
+        }
+        NodoGSS* nodo = base;
+        nodo->procesado = true;
+        if (nodo->pos == pos) {
+            activos.push_back(nodo);
+        }
+        for (size_t i = 1; i < lineal.size(); ++i) {
+            NodoGSS* siguiente = nuevo_nodo(lineal[i].estado, lineal[i].pos);
+            enlazar(siguiente, nodo, lineal[i].arbol);
+            siguiente->procesado = true;
+            nodo = siguiente;
+            if (nodo->pos == pos) {
+                activos.push_back(nodo);
+            }
+        }
+        nodo->procesado = false;
+        por_actuar.push_back(nodo);
+    }
+
+    NodoGSS* activo_con_estado(int estado) {
+        for (NodoGSS* nodo : activos) {
+            if (nodo->estado == estado) {
+                return nodo;
+            }
+        }
+        return nullptr;
+    }
+
+    void procesar_nivel(int word, size_t pos, NodoBosque*& raiz) {
+        por_desplazar.clear();
+        while (!por_actuar.empty()) {
+            NodoGSS* p = por_actuar.back();
+            por_actuar.pop_back();
+            p->procesado = true;
+            uint32_t unica;
+            size_t num;
+            const uint32_t* lista = tabla.acciones(p->estado, word, unica, num);
+            for (size_t k = 0; k < num; ++k) {
+                uint32_t act = lista[k];
+                switch (tipo_accion(act)) {
+                    case TipoAccion::SHIFT:
+                        por_desplazar.push_back({p, int(destino_accion(act))});
+                        break;
+                    case TipoAccion::REDUCE:
+                        reducciones(p, destino_accion(act), nullptr, pos, word);
+                        break;
+                    case TipoAccion::ACCEPT:
+                        raiz = p->enlaces->arbol;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    // Todas las reducciones por prod desde p; si se da enlace, solo los caminos que lo usan.
+    // Los caminos se juntan antes de reducir porque reducir agrega enlaces al GSS.
+    void reducciones(NodoGSS* p, int prod, EnlaceGSS* enlace, size_t pos, int word) {
+        int len = base_tabla.prod_len[prod];
+        vector<NodoGSS*> destinos;
+        vector<NodoBosque*> kids, camino(len);
+        buscar_caminos(p, len, enlace == nullptr, enlace, camino, destinos, kids);
+        for (size_t c = 0; c < destinos.size(); ++c) {
+            reducir_camino(destinos[c], prod, kids.data() + c * len, len, pos, word);
+        }
+    }
+
+    void buscar_caminos(NodoGSS* nodo, int restantes, bool usado, EnlaceGSS* enlace, vector<NodoBosque*>& camino,
+                        vector<NodoGSS*>& destinos, vector<NodoBosque*>& kids) {
+        if (restantes == 0) {
+            if (usado) {
+                destinos.push_back(nodo);
+                kids.insert(kids.end(), camino.begin(), camino.end());
+            }
+            return;
+        }
+        for (EnlaceGSS* e = nodo->enlaces; e; e = e->siguiente) {
+            camino[restantes - 1] = e->arbol;
+            buscar_caminos(e->destino, restantes - 1, usado || e == enlace, enlace, camino, destinos, kids);
+        }
+    }
+
+    void reducir_camino(NodoGSS* q, int prod, NodoBosque* const* kids, int len, size_t pos, int word) {
+        int A = base_tabla.prod_izq[prod];
+        int estado = base_tabla.ir_a(q->estado, A);
+        if (estado < 0) {
+            return;
+        }
+        NodoGSS* p = activo_con_estado(estado);
+        if (p) {
+            for (EnlaceGSS* e = p->enlaces; e; e = e->siguiente) {
+                if (e->destino == q) {
+                    agregar_alternativa(e->arbol, prod, kids, len);
+                    return;
+                }
+            }
+        }
+        NodoBosque* nodo = nodo_simbolo(A + base_tabla.num_terminales, q->pos, pos);
+        agregar_alternativa(nodo, prod, kids, len);
+        if (!p) {
+            p = nuevo_nodo(estado, pos);
+            enlazar(p, q, nodo);
+            activos.push_back(p);
+            por_actuar.push_back(p);
+            return;
+        }
+        // Enlace nuevo hacia un nodo que ya existia: los nodos que ya actuaron repiten sus
+        // reducciones, pero solo por los caminos que pasan por ese enlace.
+        EnlaceGSS* enlace = enlazar(p, q, nodo);
+        for (size_t i = 0; i < activos.size(); ++i) {
+            NodoGSS* m = activos[i];
+            if (!m->procesado) {
+                continue;
+            }
+            uint32_t unica;
+            size_t num;
+            const uint32_t* lista = tabla.acciones(m->estado, word, unica, num);
+            for (size_t k = 0; k < num; ++k) {
+                if (tipo_accion(lista[k]) == TipoAccion::REDUCE && base_tabla.prod_len[destino_accion(lista[k])] > 0) {
+                    reducciones(m, destino_accion(lista[k]), enlace, pos, word);
+                }
+            }
+        }
+    }
+
+    void desplazar(int word, size_t pos) {
+        NodoBosque* h = hoja(word, pos);
+        activos.clear();
+        for (const auto& [p, estado] : por_desplazar) {
+            NodoGSS* destino = activo_con_estado(estado);
+            if (!destino) {
+                destino = nuevo_nodo(estado, pos + 1);
+                activos.push_back(destino);
+            }
+            enlazar(destino, p, h);
+        }
+        por_actuar.clear();
+    }
+};
+
+// Recorre el bosque desde la raiz (tolerando ciclos) y devuelve los nodos alcanzables.
+vector<const NodoBosque*> nodos_del_bosque(const NodoBosque* raiz) {
+    vector<const NodoBosque*> orden;
+    unordered_map<const NodoBosque*, int> visto;
+    vector<const NodoBosque*> pendientes = {raiz};
+    visto[raiz] = 0;
+    while (!pendientes.empty()) {
+        const NodoBosque* nodo = pendientes.back();
+        pendientes.pop_back();
+        orden.push_back(nodo);
+        for (const Alternativa* a = nodo->alternativas; a; a = a->siguiente) {
+            for (uint32_t i = 0; i < a->num_hijos; ++i) {
+                if (visto.emplace(a->hijos[i], 0).second) {
+                    pendientes.push_back(a->hijos[i]);
+                }
+            }
+        }
+    }
+    return orden;
+}
+
+void imprimir_bosque(const NodoBosque* raiz, const Gramatica& g) {
+    vector<const NodoBosque*> orden = nodos_del_bosque(raiz);
+    unordered_map<const NodoBosque*, int> id;
+    for (size_t i = 0; i < orden.size(); ++i) id[orden[i]] = i;
+    for (const NodoBosque* nodo : orden) {
+        cout << "n" << id[nodo] << " " << g.simbolos.nombre(nodo->simbolo) << " [" << nodo->inicio << ", " << nodo->fin << ")" << endl;
+        for (const Alternativa* a = nodo->alternativas; a; a = a->siguiente) {
+            const produccion& prod = g.producciones[a->produccion];
+            cout << "  " << g.simbolos.nombre(prod.left) << " ->";
+            for (int s : prod.right) cout << " " << g.simbolos.nombre(s);
+            if (prod.right.empty()) cout << " ε";
+            cout << "  (";
+            for (uint32_t i = 0; i < a->num_hijos; ++i) cout << (i ? " n" : "n") << id[a->hijos[i]];
+            cout << ")" << endl;
+        }
+    }
+}
+
+int parse_glr(const Gramatica& g, const Automata& automata, bool mostrar_bosque) {
+    TablaGLR tabla = construir_tabla_glr(automata, g);
+    cout << "Celdas con conflicto: " << tabla.conflictos.size() << endl;
+    vector<int> input;
+    if (!leer_cadena(g.simbolos, input)) {
+        return 0;
+    }
+    ParserGLR parser(tabla);
+    Arena arena;
+    ResultadoGLR r = parser.analizar(input.data(), input.size(), arena);
+    if (!r.aceptada) {
+        cout << "Cadena rechazada (GLR, sin acciones tras " << r.pos << " tokens)." << endl;
+        return 0;
+    }
+    vector<const NodoBosque*> nodos = nodos_del_bosque(r.raiz);
+    size_t ambiguos = 0;
+    for (const NodoBosque* nodo : nodos) {
+        ambiguos += nodo->alternativas && nodo->alternativas->siguiente;
+    }
+    cout << "Cadena aceptada (bosque: " << nodos.size() << " nodos, " << ambiguos << " ambiguos; "
+         << r.tokens_glr << " de " << input.size() + 1 << " tokens con GSS)." << endl;
+    if (mostrar_bosque) {
+        imprimir_bosque(r.raiz, g);
+    }
+    return 0;
+}
+
+// Entrada desde stdin: una linea completa o, con --flujo, terminal por terminal hasta EOF.
+template <typename Tabla>
+void analizar_stdin(const TablaSimbolos& simbolos, const Tabla& tabla, bool flujo, const OpcionesArbol& arbol) {
+    if (flujo) {
+        parse_flujo(cin, simbolos, tabla, arbol);
+        return;
+    }
+    vector<int> input;
+    if (!leer_cadena(simbolos, input)) {
+        return;
+    }
+    if (!arbol.activo) {
+        parse_string(input, simbolos, tabla);
+        return;
+    }
+    SesionArbol sesion(tabla, arbol.conservar);
+    ParserEmpuje<Tabla> parser(tabla);
+    parser.construir_arbol(&sesion.constructor);
+    for (int id : input) {
+        if (!parser.alimentar(id)) {
+            break;
+        }
+    }
+    const ResultadoParse& r = parser.terminar();
+    informar_resultado(r, simbolos);
+    if (r.aceptada) {
+        informar_arbol(sesion, r.pos, simbolos, nullptr);
+    }
+}
+
+// Generacion de un parser C++ independiente (--generar-cpp): un encabezado con el enum de
+// simbolos y un fuente con las tablas comprimidas como arreglos constexpr, o con un
+// switch por estado si se pide --directo. El programa generado no lee la gramatica ni
+// construye tablas.
+string identificador_simbolo(const string& nombre) {
+    if (nombre == "$") {
+        return "SIM_FIN";
+    }
+    string id = "SIM_";
+    for (unsigned char c : nombre) {
+        if (isalnum(c) || c == '_') {
+            id += c;
+        } else {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "_x%02X", c);
+            id += hex;
+        }
+    }
+    return id;
+}
+
+string literal_cpp(const string& texto) {
+    string r = "\"";
+    for (unsigned char c : texto) {
+        if (c == '"' || c == '\\') {
+            r += '\\';
+            r += c;
+        } else if (c < 0x20 || c >= 0x7f) {
+            char oct[8];
+            snprintf(oct, sizeof(oct), "\\%03o", c);
+            r += oct;
+        } else {
+            r += c;
+        }
+    }
+    return r + "\"";
+}
+
+template <typename T>
+void emitir_arreglo(ostream& out, const string& tipo, const string& nombre, const T* datos, size_t n) {
+    out << "static constexpr " << tipo << " " << nombre << "[" << max<size_t>(n, 1) << "] = {";
+    for (size_t i = 0; i < n; ++i) {
+        out << (i % 16 == 0 ? "\n    " : " ") << datos[i] << ",";
+    }
+    if (n == 0) {
+        out << "0";
+    }
+    out << "\n};\n\n";
+}
+
+template <typename T>
+void emitir_arreglo(ostream& out, const string& tipo, const string& nombre, const vector<T>& v) {
+    emitir_arreglo(out, tipo, nombre, v.data(), v.size());
+}
+
+bool generar_cpp(const string& prefijo, const Gramatica& g, const TablaLR& tabla, const TablaComprimida& comprimida, bool directo) {
+    string base_nombre = prefijo.substr(prefijo.find_last_of('/') + 1);
+    ofstream h(prefijo + ".h");
+    ofstream cpp(prefijo + ".cpp");
+    if (!h.is_open() || !cpp.is_open()) {
+        cerr << "Error: no se pudo escribir " << prefijo << ".h/.cpp" << endl;
+        return false;
+    }
+
+    const TablaSimbolos& simbolos = g.simbolos;
+    h << "// Generado por parser --generar-cpp. No editar.\n";
+    h << "#pragma once\n\n#include <cstddef>\n\n";
+    h << "namespace parser_generado {\n\n";
+    h << "enum Simbolo : int {\n";
+    set<string> usados;
+    for (int id = 0; id < simbolos.size(); ++id) {
+        string ident = identificador_simbolo(simbolos.nombre(id));
+        while (!usados.insert(ident).second) {
+            ident += "_";
+        }
+        h << "    " << ident << " = " << id << ",  // " << simbolos.nombre(id) << "\n";
+    }
+    h << "};\n\n";
+    h << "constexpr int NUM_TERMINALES = " << tabla.num_terminales << ";\n";
+    h << "constexpr int NUM_NO_TERMINALES = " << tabla.num_no_terminales << ";\n";
+    h << "constexpr int NUM_ESTADOS = " << tabla.num_estados << ";\n";
+    h << "constexpr int FIN = " << tabla.fin << ";\n\n";
+    h << "extern const char* const NOMBRES[" << simbolos.size() << "];\n\n";
+    h << "// Id del terminal con ese nombre, o -1.\n";
+    h << "int buscar_terminal(const char* nombre);\n\n";
+    h << "// Analiza una secuencia de ids de terminales (sin el \"$\" final).\n";
+    h << "bool analizar(const int* tokens, std::size_t n);\n\n";
+    h << "}  // namespace parser_generado\n";
+
+    cpp << "// Generado por parser --generar-cpp" << (directo ? " --directo" : "") << ". No editar.\n";
+    cpp << "#include \"" << base_nombre << ".h\"\n\n";
+    cpp << "#include <cstdint>\n#include <cstring>\n#include <vector>\n\n";
+    cpp << "namespace parser_generado {\n\n";
+
+    cpp << "const char* const NOMBRES[" << simbolos.size() << "] = {\n";
+    for (int id = 0; id < simbolos.size(); ++id) {
+        cpp << "    " << literal_cpp(simbolos.nombre(id)) << ",\n";
+    }
+    cpp << "};\n\n";
+
+    vector<int> ordenados;
+    for (int t = 0; t < simbolos.num_terminales; ++t) ordenados.push_back(t);
+    sort(ordenados.begin(), ordenados.end(), [&](int a, int b) { return simbolos.nombre(a) < simbolos.nombre(b); });
+    emitir_arreglo(cpp, "int", "TERMINALES_ORDENADOS", ordenados);
+    cpp << "int buscar_terminal(const char* nombre) {\n"
+           "    int lo = 0, hi = NUM_TERMINALES;\n"
+           "    while (lo < hi) {\n"
+           "        int mid = (lo + hi) / 2;\n"
+           "        int c = std::strcmp(NOMBRES[TERMINALES_ORDENADOS[mid]], nombre);\n"
+           "        if (c == 0) return TERMINALES_ORDENADOS[mid];\n"
+           "        if (c < 0) lo = mid + 1; else hi = mid;\n"
+           "    }\n"
+           "    return -1;\n"
+           "}\n\n";
+
+    emitir_arreglo(cpp, "int32_t", "PROD_IZQ", comprimida.prod_izq);
+    emitir_arreglo(cpp, "int32_t", "PROD_LEN", comprimida.prod_len);
+
+    if (!directo) {
+        emitir_arreglo(cpp, "int32_t", "FILA_ACCION", comprimida.fila_accion);
+        emitir_arreglo(cpp, "uint32_t", "ACCION_DEFECTO", comprimida.accion_defecto);
+        emitir_arreglo(cpp, "int32_t", "ACCION_BASE", comprimida.peine_accion.base);
+        emitir_arreglo(cpp, "int32_t", "ACCION_CHECK", comprimida.peine_accion.check);
+        emitir_arreglo(cpp, "uint32_t", "ACCION_VALOR", comprimida.peine_accion.valor);
+        emitir_arreglo(cpp, "int32_t", "GOTO_DEFECTO", comprimida.goto_defecto);
+        emitir_arreglo(cpp, "int32_t", "GOTO_BASE", comprimida.peine_goto.base);
+        emitir_arreglo(cpp, "int32_t", "GOTO_CHECK", comprimida.peine_goto.check);
+        emitir_arreglo(cpp, "uint32_t", "GOTO_VALOR", comprimida.peine_goto.valor);
+        cpp << "static inline uint32_t accion(int estado, int t) {\n"
+               "    std::size_t i = std::size_t(ACCION_BASE[FILA_ACCION[estado]] + t);\n"
+               "    if (i < sizeof(ACCION_CHECK) / sizeof(ACCION_CHECK[0]) && ACCION_CHECK[i] == FILA_ACCION[estado]) return ACCION_VALOR[i];\n"
+               "    return ACCION_DEFECTO[estado];\n"
+               "}\n\n"
+               "static inline int32_t ir_a(int estado, int A) {\n"
+               "    std::size_t i = std::size_t(GOTO_BASE[A] + estado);\n"
+               "    if (i < sizeof(GOTO_CHECK) / sizeof(GOTO_CHECK[0]) && GOTO_CHECK[i] == A) return int32_t(GOTO_VALOR[i]);\n"
+               "    return GOTO_DEFECTO[A];\n"
+               "}\n\n";
+    } else {
+        // Un switch por estado con los mismos valores que la tabla comprimida: las celdas
+        // explicitas como casos y la reduccion por defecto en default.
+        cpp << "static inline uint32_t accion(int estado, int t) {\n    switch (estado) {\n";
+        for (int e = 0; e < tabla.num_estados; ++e) {
+            cpp << "    case " << e << ":\n        switch (t) {\n";
+            for (int t = 0; t < tabla.num_terminales; ++t) {
+                uint32_t a = tabla.accion(e, t);
+                if (a != 0 && a != comprimida.accion_defecto[e]) {
+                    cpp << "        case " << t << ": return " << a << "u;\n";
+                }
+            }
+            cpp << "        default: return " << comprimida.accion_defecto[e] << "u;\n        }\n";
+        }
+        cpp << "    }\n    return 0;\n}\n\n";
+        cpp << "static inline int32_t ir_a(int estado, int A) {\n    switch (A) {\n";
+        for (int A = 0; A < tabla.num_no_terminales; ++A) {
+            cpp << "    case " << A << ":\n        switch (estado) {\n";
+            for (int e = 0; e < tabla.num_estados; ++e) {
+                if (tabla.ir_a(e, A) >= 0 && tabla.ir_a(e, A) != comprimida.goto_defecto[A]) {
+                    cpp << "        case " << e << ": return " << tabla.ir_a(e, A) << ";\n";
+                }
+            }
+            cpp << "        default: return " << comprimida.goto_defecto[A] << ";\n        }\n";
+        }
+        cpp << "    }\n    return -1;\n}\n\n";
+    }
+
+    cpp << "bool analizar(const int* tokens, std::size_t n) {\n"
+           "    static thread_local std::vector<int> pila;\n"
+           "    pila.clear();\n"
+           "    pila.push_back(0);\n"
+           "    std::size_t pos = 0;\n"
+           "    int word = pos < n ? tokens[pos] : FIN;\n"
+           "    while (true) {\n"
+           "        uint32_t act = accion(pila.back(), word);\n"
+           "        switch (act >> 30) {\n"
+           "        case 1:\n"
+           "            pila.push_back(int(act & 0x3FFFFFFF));\n"
+           "            ++pos;\n"
+           "            word = pos < n ? tokens[pos] : FIN;\n"
+           "            break;\n"
+           "        case 2: {\n"
+           "            uint32_t prod = act & 0x3FFFFFFF;\n"
+           "            pila.resize(pila.size() - PROD_LEN[prod]);\n"
+           "            int32_t siguiente = ir_a(pila.back(), PROD_IZQ[prod]);\n"
+           "            if (siguiente < 0) return false;\n"
+           "            pila.push_back(siguiente);\n"
+           "            break;\n"
+           "        }\n"
+           "        case 3:\n"
+           "            return true;\n"
+           "        default:\n"
+           "            return false;\n"
+           "        }\n"
+           "    }\n"
+           "}\n\n";
+    cpp << "}  // namespace parser_generado\n";
+    return true;
+}
+
+// --generar-scanner: las tablas del AFD de tokens.txt en un header autocontenido, con la
+// busqueda de la coincidencia mas larga sobre ellas.
+bool generar_scanner_cpp(const string& prefijo, const TablasScanner& t) {
+    ofstream h(prefijo + ".h");
+    if (!h.is_open()) {
+        cerr << "Error: no se pudo escribir " << prefijo << ".h" << endl;
+        return false;
+    }
+    bool estrecha = t.num_estados <= 256;
+    h << "// Generado por parser --generar-scanner. No editar.\n";
+    h << "#pragma once\n\n#include <cstdint>\n\n";
+    h << "namespace scanner_generado {\n\n";
+    h << "enum Accion : int { TOKEN, IGNORAR, ERROR };\n\n";
+    h << "static constexpr int NUM_CLASES = " << t.num_clases << ";\n";
+    h << "static constexpr int NUM_ESTADOS = " << t.num_estados << ";\n";
+    h << "static constexpr int PRIMER_ACEPTADOR = " << t.primer_aceptador << ";\n\n";
+    emitir_arreglo(h, "uint8_t", "CLASE", vector<int>(t.clase, t.clase + 256));
+    emitir_arreglo(h, estrecha ? "uint8_t" : "uint16_t", "TRANSICION", vector<int>(t.transicion.begin(), t.transicion.end()));
+    emitir_arreglo(h, "int16_t", "REGLA", vector<int>(t.regla.begin(), t.regla.end()));
+    vector<int> acciones;
+    h << "static constexpr const char* NOMBRE_REGLA[" << t.reglas.size() << "] = {\n";
+    for (const ReglaToken& r : t.reglas) {
+        h << "    " << literal_cpp(r.nombre) << ",\n";
+        acciones.push_back(int(r.accion));
+    }
+    h << "};\n\n";
+    emitir_arreglo(h, "uint8_t", "ACCION_REGLA", acciones);
+    h << "// Coincidencia mas larga desde p: devuelve su fin y la regla, o nullptr si ninguna\n"
+         "// regla reconoce un prefijo.\n"
+         "inline const char* siguiente_token(const char* p, const char* fin, int& regla) {\n"
+         "    const char* fin_token = nullptr;\n"
+         "    int estado = 1;\n"
+         "    while (p < fin) {\n"
+         "        estado = TRANSICION[estado * NUM_CLASES + CLASE[(unsigned char)*p++]];\n"
+         "        if (estado == 0) break;\n"
+         "        if (estado >= PRIMER_ACEPTADOR) {\n"
+         "            regla = REGLA[estado];\n"
+         "            fin_token = p;\n"
+         "        }\n"
+         "    }\n"
+         "    return fin_token;\n"
+         "}\n\n";
+    h << "}  // namespace scanner_generado\n";
+    return true;
+}
+
+const vector<string> term_order = {"(", ")", "create", "paper", "$", "in_lv", "int", "comma", "out_lv", "assign", "nom", "identifier", "string", "float", "boolv", "boolf", "int_value", "string_value", "float_value", "boolv", "boolf", "in_op", "out_op", "then", "else", "while", "from", "to", "calculate", "in", "sqrt", "qbic", "similar", "less_than", "greater_than", "less_equal", "greater_equal", "not_equal", "increment", "decrement", "plus", "minus", "multi", "division", "power"};
+const vector<string> goto_order = {"S'", "P", "SL", "S", "CC", "D", "T", "V", "BO", "OP", "IF", "W", "F", "C", "R", "SQ", "QB", "A", "CN", "CM", "ID", "E", "EP", "TRM", "TP", "FC"};
+
+typedef vector<pair<string, vector<string>>> Reglas;
+
+bool leer_reglas(const string& archivo, Reglas& reglas) {
+    ifstream infile(archivo);
+    if (!infile.is_open()) {
+        cerr << "Error al abrir el archivo de gramatica." << endl;
+        return false;
+    }
+
+    string line;
+    while(getline(infile, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t flecha = line.find("->");
+
+        if (flecha == string::npos) {
+            cerr << "Error: la linea no contiene '->': " << line << endl;
+            continue;
+        }
+
+        string left = line.substr(0, flecha);
+        string right_side = line.substr(flecha + 2);
+
+        left.erase(0, left.find_first_not_of(" \t"));
+        left.erase(left.find_last_not_of(" \t") + 1);
+
+        vector<string> right;
+        stringstream ss(right_side);
+        string simbolo;
+
+        while (ss >> simbolo) {
+            right.push_back(simbolo);
+        }
+
+        if (right.size() == 1 && right[0] == "ε") {
+            right.clear();
+        }
+
+        reglas.push_back({left, right});
+    }
+    return true;
+}
+
+Gramatica construir_gramatica(const Reglas& reglas) {
+    set<string> noTerminales;
+    for (const auto& regla : reglas) {
+        noTerminales.insert(regla.first);
+    }
+
+    set<string> all_symbols;
+    for (const auto& regla : reglas) {
+        for (const auto& sym : regla.second)
+            all_symbols.insert(sym);
+    }
+
+    all_symbols.erase("ε");
+
+    vector<string> terminales;
+    for (const auto& t : term_order) {
+        if (all_symbols.find(t) != all_symbols.end() || t == "$")
+            terminales.push_back(t);
+    }
+    for (const auto& sym : all_symbols) {
+        if (noTerminales.find(sym) == noTerminales.end() && find(terminales.begin(), terminales.end(), sym) == terminales.end())
+            terminales.push_back(sym);
+    }
+    if (find(terminales.begin(), terminales.end(), "$") == terminales.end())
+        terminales.push_back("$");
+
+    vector<string> no_terminales;
     for (const auto& nt : goto_order) {
-        if (find(no_terminales.begin(), no_terminales.end(), nt) != no_terminales.end())
-            cout << nt << "\t";
+        if (noTerminales.find(nt) != noTerminales.end())
+            no_terminales.push_back(nt);
+    }
+    for (const auto& nt : noTerminales) {
+        if (find(no_terminales.begin(), no_terminales.end(), nt) == no_terminales.end())
+            no_terminales.push_back(nt);
+    }
+
+    Gramatica g;
+    for (const auto& t : terminales) {
+        g.simbolos.agregar(t);
+    }
+    g.simbolos.num_terminales = g.simbolos.size();
+    for (const auto& nt : no_terminales) {
+        g.simbolos.agregar(nt);
+    }
+    g.fin = g.simbolos.id("$");
+
+    g.producciones_de.resize(g.simbolos.size());
+    for (const auto& regla : reglas) {
+        produccion prod{g.simbolos.id(regla.first), {}};
+        for (const auto& sym : regla.second) {
+            prod.right.push_back(g.simbolos.id(sym));
+        }
+        g.producciones_de[prod.left].push_back(g.producciones.size());
+        g.producciones.push_back(prod);
+    }
+
+    // Orden de exploracion de simbolos por nombre, igual que el recorrido original sobre set<string>.
+    for (int id = 0; id < g.simbolos.size(); ++id) {
+        if (all_symbols.count(g.simbolos.nombre(id)) || id == g.fin) {
+            g.orden_simbolos.push_back(id);
+        }
+    }
+    sort(g.orden_simbolos.begin(), g.orden_simbolos.end(), [&](int a, int b) {
+        return g.simbolos.nombre(a) < g.simbolos.nombre(b);
+    });
+
+    for (const auto& nombre : goto_order) {
+        int X = g.simbolos.id(nombre);
+        if (X >= 0) {
+            g.orden_inicial.push_back(X);
+        }
+    }
+    return g;
+}
+
+// Cierre por punto fijo con busqueda lineal de producciones; se conserva solo como
+// referencia para --bench-closure.
+ConjuntoItems closure_punto_fijo(const ConjuntoItems& I, const Gramatica& g, const AnalisisGramatica& analisis) {
+    ConjuntoItems C = I;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (size_t i = 0; i < C.size(); ++i) {
+            const produccion& prod = g.producciones[C[i].idx];
+            if (C[i].dot_pos < prod.right.size()) {
+                int B = prod.right[C[i].dot_pos];
+                if (g.simbolos.es_no_terminal(B)) {
+                    ConjuntoTerminales lookaheads = analisis.first_sufijo[C[i].idx][C[i].dot_pos + 1];
+                    if (analisis.sufijo_anulable[C[i].idx][C[i].dot_pos + 1]) {
+                        lookaheads.unir(C[i].lookahead);
+                    }
+                    for (int j = 0; j < g.producciones.size(); ++j) {
+                        if (g.producciones[j].left == B) {
+                            auto it = find_if(C.begin(), C.end(), [&](const Item& o) { return o.idx == j && o.dot_pos == 0; });
+                            if (it == C.end()) {
+                                C.push_back({j, 0, lookaheads});
+                                changed = true;
+                            } else if (it->lookahead.unir(lookaheads)) {
+                                changed = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    sort(C.begin(), C.end(), menor_nucleo);
+    return C;
+}
+
+// Gramatica sintetica de sentencias y expresiones con unas 6*n + 14 producciones. Una
+// sentencia puede ser tambien una cadena A0 -> A1 x0 | A1 y0 | c0 A0, ..., A(n-1) -> a |
+// c(n-1) A0: el cierre de I0 y el del sucesor de cada ci recorren la cadena entera, unos
+// 3*n items de los que 2*n tienen el punto antes de un no terminal.
+Reglas gramatica_sintetica(int n) {
+    Reglas reglas = {{"S'", {"P"}}, {"P", {"P", "ST"}}, {"P", {"ST"}}};
+    for (int i = 0; i < n; ++i) {
+        string k = to_string(i);
+        reglas.push_back({"ST", {"kw" + k, "(", "E", ")", "B" + k}});
+        reglas.push_back({"B" + k, {"{", "P", "}"}});
+        reglas.push_back({"B" + k, {"id" + k, "=", "E", ";"}});
+    }
+    reglas.push_back({"ST", {"A0", ";"}});
+    for (int i = 0; i < n; ++i) {
+        string k = to_string(i), a = "A" + k;
+        if (i + 1 < n) {
+            reglas.push_back({a, {"A" + to_string(i + 1), "x" + k}});
+            reglas.push_back({a, {"A" + to_string(i + 1), "y" + k}});
+        } else {
+            reglas.push_back({a, {"a"}});
+        }
+        reglas.push_back({a, {"c" + k, "A0"}});
+    }
+    reglas.push_back({"E", {"E", "+", "T"}});
+    reglas.push_back({"E", {"E", "-", "T"}});
+    reglas.push_back({"E", {"T"}});
+    reglas.push_back({"T", {"T", "*", "F"}});
+    reglas.push_back({"T", {"T", "/", "F"}});
+    reglas.push_back({"T", {"F"}});
+    reglas.push_back({"F", {"(", "E", ")"}});
+    reglas.push_back({"F", {"id"}});
+    reglas.push_back({"F", {"num"}});
+    reglas.push_back({"F", {"-", "F"}});
+    return reglas;
+}
+
+template <typename F>
+double medir_ms(F f) {
+    auto inicio = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+}
+
+int bench_closure(int n) {
+    Gramatica g = construir_gramatica(gramatica_sintetica(n));
+    AnalisisGramatica analisis = analizar_gramatica(g.producciones, g.simbolos);
+
+    // Nucleos de I0 y de todos sus sucesores: cubren cierres grandes y pequenos.
+    ConjuntoTerminales fin(g.simbolos.num_terminales);
+    fin.insertar(g.fin);
+    vector<ConjuntoItems> nucleos = {{{0, 0, fin}}};
+    ConjuntoItems I0 = closure(nucleos[0], g, analisis);
+    for (int X : g.orden_simbolos) {
+        ConjuntoItems J;
+        for (const auto& item : I0) {
+            const produccion& prod = g.producciones[item.idx];
+            if (item.dot_pos < prod.right.size() && prod.right[item.dot_pos] == X) {
+                J.push_back({item.idx, item.dot_pos + 1, item.lookahead});
+            }
+        }
+        if (!J.empty()) {
+            nucleos.push_back(J);
+        }
+    }
+
+    size_t items_worklist = 0, items_punto_fijo = 0;
+    auto contar = [](const ConjuntoItems& C) {
+        size_t n = 0;
+        for (const auto& item : C) n += item.lookahead.tamano();
+        return n;
+    };
+    for (const auto& K : nucleos) {
+        items_worklist += contar(closure(K, g, analisis));
+        items_punto_fijo += contar(closure_punto_fijo(K, g, analisis));
+    }
+
+    // Cada version repite todos los cierres hasta juntar al menos 200 ms, para que el
+    // tiempo por ronda quede muy por encima de la resolucion del reloj.
+    auto ms_por_ronda = [&](auto cierre) {
+        size_t rondas = 0;
+        double ms = 0;
+        while (ms < 200) {
+            ms += medir_ms([&] {
+                for (const auto& K : nucleos) cierre(K);
+            });
+            ++rondas;
+        }
+        return ms / rondas;
+    };
+    double ms_worklist = ms_por_ronda([&](const ConjuntoItems& K) { return closure(K, g, analisis); });
+    double ms_punto_fijo = ms_por_ronda([&](const ConjuntoItems& K) { return closure_punto_fijo(K, g, analisis); });
+
+    cout << "Producciones: " << g.producciones.size() << ", cierres: " << nucleos.size() << ", items: " << items_worklist << endl;
+    cout << "Punto fijo: " << ms_punto_fijo << " ms por ronda" << endl;
+    cout << "Worklist:   " << ms_worklist << " ms por ronda" << endl;
+    cout << "Aceleracion: " << ms_punto_fijo / ms_worklist << "x" << endl;
+    return items_worklist == items_punto_fijo ? 0 : 1;
+}
+
+// Bucle original sobre map<int, map<...>> con acciones en texto; se conserva solo como
+// referencia para --bench-parse.
+bool parse_string_mapas(const vector<int>& input, const vector<produccion>& producciones, int fin, const map<int, map<int, string>>& action, const map<int, map<int, int>>& goto_table) {
+    vector<int> state_stack;
+    vector<int> symbol_stack;
+
+    state_stack.push_back(0);
+    symbol_stack.push_back(fin);
+
+    size_t pos = 0;
+    int word = (pos < input.size()) ? input[pos] : fin;
+
+    while (true) {
+        int state = state_stack.back();
+
+        auto it = action.find(state);
+        if (it == action.end() || it->second.find(word) == it->second.end()) {
+            return false;
+        }
+
+        string act = it->second.at(word);
+
+        if (act[0] == 'r') {
+            int prod_idx = stoi(act.substr(1));
+            const produccion& prod = producciones[prod_idx];
+            int rhs_size = prod.right.size();
+
+            if (state_stack.size() < rhs_size || symbol_stack.size() < rhs_size) {
+                return false;
+            }
+            for (int i = 0; i < rhs_size; ++i) {
+                symbol_stack.pop_back();
+                state_stack.pop_back();
+            }
+
+            if (state_stack.empty()) {
+                return false;
+            }
+            int top_state = state_stack.back();
+            symbol_stack.push_back(prod.left);
+
+            if (goto_table.find(top_state) == goto_table.end() ||
+                goto_table.at(top_state).find(prod.left) == goto_table.at(top_state).end()) {
+                return false;
+            }
+            int next_state = goto_table.at(top_state).at(prod.left);
+            state_stack.push_back(next_state);
+        }
+        else if (act[0] == 's') {
+            int next_state = stoi(act.substr(1));
+            symbol_stack.push_back(word);
+            state_stack.push_back(next_state);
+
+            ++pos;
+            word = (pos < input.size()) ? input[pos] : fin;
+        }
+        else if (act == "acc") {
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+}
+
+// Genera una oracion aleatoria de la gramatica. Pasado cierto tamano cada no terminal se
+// expande con la produccion de derivacion mas corta para asegurar que termine.
+vector<int> generar_oracion(const Gramatica& g, mt19937& rng, size_t tamano_objetivo) {
+    const int infinito = INT32_MAX / 2;
+    vector<int> minimo(g.simbolos.size(), infinito);
+    vector<int> prod_minima(g.simbolos.size(), -1);
+    for (int t = 0; t < g.simbolos.num_terminales; ++t) {
+        minimo[t] = 1;
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t p = 0; p < g.producciones.size(); ++p) {
+            long long total = 0;
+            for (int sym : g.producciones[p].right) total += minimo[sym];
+            if (total < minimo[g.producciones[p].left]) {
+                minimo[g.producciones[p].left] = total;
+                prod_minima[g.producciones[p].left] = p;
+                changed = true;
+            }
+        }
+    }
+
+    vector<int> oracion;
+    vector<int> pendientes = {g.producciones[0].left};
+    while (!pendientes.empty()) {
+        int sym = pendientes.back();
+        pendientes.pop_back();
+        if (g.simbolos.es_terminal(sym)) {
+            oracion.push_back(sym);
+            continue;
+        }
+        const auto& opciones = g.producciones_de[sym];
+        int p = prod_minima[sym];
+        if (oracion.size() + pendientes.size() < tamano_objetivo) {
+            p = opciones[rng() % opciones.size()];
+        }
+        const auto& right = g.producciones[p].right;
+        for (auto it = right.rbegin(); it != right.rend(); ++it) {
+            pendientes.push_back(*it);
+        }
+    }
+    return oracion;
+}
+
+int bench_parse(const Gramatica& g, const TablaLR& tabla, const VistaComprimida& comprimida, size_t total_tokens) {
+    map<int, map<int, string>> action;
+    map<int, map<int, int>> goto_table;
+    for (int e = 0; e < tabla.num_estados; ++e) {
+        for (int t = 0; t < tabla.num_terminales; ++t) {
+            if (tabla.accion(e, t)) action[e][t] = accion_texto(tabla.accion(e, t));
+        }
+        for (int A = 0; A < tabla.num_no_terminales; ++A) {
+            if (tabla.ir_a(e, A) >= 0) goto_table[e][A + tabla.num_terminales] = tabla.ir_a(e, A);
+        }
+    }
+
+    mt19937 rng(12345);
+    vector<vector<int>> oraciones;
+    size_t tokens = 0;
+    while (tokens < total_tokens) {
+        oraciones.push_back(generar_oracion(g, rng, 64));
+        tokens += oraciones.back().size() + 1;
+    }
+
+    size_t aceptadas_mapas = 0, aceptadas_tabla = 0;
+    double ms_mapas = medir_ms([&] {
+        for (const auto& o : oraciones) aceptadas_mapas += parse_string_mapas(o, g.producciones, g.fin, action, goto_table);
+    });
+    vector<int> pila;
+    pila.reserve(1024);
+    double ms_tabla = medir_ms([&] {
+        for (const auto& o : oraciones) aceptadas_tabla += analizar(tabla, o.data(), o.size(), pila).aceptada;
+    });
+    size_t aceptadas_comprimida = 0;
+    double ms_comprimida = medir_ms([&] {
+        for (const auto& o : oraciones) aceptadas_comprimida += analizar(comprimida, o.data(), o.size(), pila).aceptada;
+    });
+
+    cout << "Oraciones: " << oraciones.size() << ", tokens: " << tokens << ", aceptadas: " << aceptadas_tabla << endl;
+    cout << "Mapas:        " << tokens / (ms_mapas / 1000) << " tokens/s" << endl;
+    cout << "Tabla plana:  " << tokens / (ms_tabla / 1000) << " tokens/s" << endl;
+    cout << "Comprimida:   " << tokens / (ms_comprimida / 1000) << " tokens/s" << endl;
+    cout << "Aceleracion:  " << ms_mapas / ms_tabla << "x" << endl;
+    return aceptadas_mapas == aceptadas_tabla && aceptadas_tabla == aceptadas_comprimida ? 0 : 1;
+}
+
+int comparar_modos(const Gramatica& g, int hilos) {
+    AnalisisGramatica analisis = analizar_gramatica(g.producciones, g.simbolos);
+    cout << "Modo\tEstados\tTiempo (ms)";
+    if (hilos > 1) {
+        cout << "\t" << hilos << " hilos (ms)";
+    }
+    cout << endl;
+    bool iguales = true;
+    for (const string modo : {"lr1", "lalr", "minimo"}) {
+        Automata automata;
+        double ms = medir_ms([&] {
+            automata = construir_segun_modo(modo, g, analisis);
+        });
+        cout << modo << "\t" << automata.estados.size() << "\t" << ms;
+        if (hilos > 1) {
+            Automata paralelo;
+            double ms_paralelo = medir_ms([&] {
+                paralelo = construir_segun_modo(modo, g, analisis, hilos);
+            });
+            cout << "\t" << ms_paralelo;
+            TablaLR a = construir_tabla(automata, g), b = construir_tabla(paralelo, g);
+            iguales = iguales && a.acciones == b.acciones && a.gotos == b.gotos;
+        }
+        cout << endl;
+    }
+    return iguales ? 0 : 1;
+}
+
+// Modo lote (--lote ruta): un archivo aporta una entrada por linea y un directorio una
+// entrada por archivo. Las entradas se reparten entre los hilos del pool, que comparten la
+// tabla de solo lectura y reutilizan sus propias pilas; por entrada solo se guarda si fue
+// aceptada y cuanto tardo.
+bool leer_entradas_lote(const string& ruta, vector<string>& entradas) {
+    error_code ec;
+    if (filesystem::is_directory(ruta, ec)) {
+        vector<string> archivos;
+        for (const auto& entrada : filesystem::directory_iterator(ruta, ec)) {
+            if (entrada.is_regular_file()) {
+                archivos.push_back(entrada.path().string());
+            }
+        }
+        sort(archivos.begin(), archivos.end());
+        for (const auto& archivo : archivos) {
+            ifstream in(archivo);
+            entradas.emplace_back(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }
+        return !ec;
+    }
+    ifstream in(ruta);
+    if (!in.is_open()) {
+        return false;
+    }
+    string linea;
+    while (getline(in, linea)) {
+        entradas.push_back(linea);
+    }
+    return true;
+}
+
+template <typename Tabla>
+int parsear_lote(const string& ruta, const TablaSimbolos& simbolos, const Tabla& tabla, int num_hilos) {
+    vector<string> entradas;
+    if (!leer_entradas_lote(ruta, entradas)) {
+        cerr << "Error: no se pudo leer el lote '" << ruta << "'." << endl;
+        return 1;
+    }
+    size_t n = entradas.size();
+    vector<char> aceptada(n, 0);
+    vector<uint32_t> num_tokens(n, 0);
+    vector<double> latencia_us(n, 0);
+
+    PoolHilos pool(num_hilos);
+    double ms = medir_ms([&] {
+        pool.paralelo_para(n, [&](size_t i) {
+            static thread_local vector<int> tokens, pila;
+            auto inicio = chrono::steady_clock::now();
+            tokens.clear();
+            const string& texto = entradas[i];
+            bool valida = true;
+            size_t p = 0;
+            while (valida) {
+                while (p < texto.size() && isspace((unsigned char)texto[p])) ++p;
+                if (p == texto.size()) {
+                    break;
+                }
+                size_t q = p;
+                while (q < texto.size() && !isspace((unsigned char)texto[q])) ++q;
+                int id = simbolos.id(texto.substr(p, q - p));
+                valida = id >= 0 && simbolos.es_terminal(id);
+                tokens.push_back(id);
+                p = q;
+            }
+            aceptada[i] = valida && analizar(tabla, tokens.data(), tokens.size(), pila).aceptada;
+            num_tokens[i] = tokens.size();
+            latencia_us[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - inicio).count();
+        });
+    });
+
+    size_t aceptadas = count(aceptada.begin(), aceptada.end(), 1);
+    size_t tokens = 0;
+    for (uint32_t t : num_tokens) tokens += t;
+    sort(latencia_us.begin(), latencia_us.end());
+    auto percentil = [&](double q) {
+        return n == 0 ? 0.0 : latencia_us[min(n - 1, size_t(q * n))];
+    };
+    cout << "Entradas: " << n << ", aceptadas: " << aceptadas << ", rechazadas: " << n - aceptadas << ", tokens: " << tokens << endl;
+    cout << "Hilos: " << num_hilos << ", tiempo: " << ms << " ms" << endl;
+    cout << "Rendimiento: " << n / (ms / 1000) << " entradas/s, " << tokens / (ms / 1000) << " tokens/s" << endl;
+    cout << "Latencia por entrada: p50 " << percentil(0.50) << " us, p99 " << percentil(0.99) << " us" << endl;
+    return 0;
+}
+
+// Rutas de --lexear: los directorios se recorren enteros y sus archivos se toman en orden
+// de nombre.
+vector<string> expandir_rutas(const vector<string>& rutas) {
+    vector<string> archivos;
+    for (const string& ruta : rutas) {
+        if (!filesystem::is_directory(ruta)) {
+            archivos.push_back(ruta);
+            continue;
+        }
+        vector<string> dentro;
+        for (const auto& entrada : filesystem::recursive_directory_iterator(ruta)) {
+            if (entrada.is_regular_file()) {
+                dentro.push_back(entrada.path().string());
+            }
+        }
+        sort(dentro.begin(), dentro.end());
+        archivos.insert(archivos.end(), dentro.begin(), dentro.end());
+    }
+    return archivos;
+}
+
+// Lexea los archivos en el pool: cada hilo tiene su Scanner y su buffer de tokens, que
+// procesar(i, scanner, tokens) recibe mientras la fuente sigue mapeada. Los mensajes de
+// error de cada archivo quedan en errores[i], y abierto[i] en 0 si no se pudo abrir.
+template <typename Procesar>
+void lexear_archivos(const vector<string>& archivos, PoolHilos& pool, vector<string>& errores,
+                     vector<char>& abierto, Procesar procesar) {
+    errores.assign(archivos.size(), "");
+    abierto.assign(archivos.size(), 0);
+    pool.paralelo_para(archivos.size(), [&](size_t i) {
+        static thread_local Scanner scanner;
+        static thread_local vector<TokenVista> tokens;
+        ostringstream mensajes;
+        scanner.errores = &mensajes;
+        abierto[i] = scanner.abrir(archivos[i]);
+        if (abierto[i]) {
+            tokens.clear();
+            for (TokenVista t = scanner.siguiente(); t.type != TokenType::END_OF_FILE; t = scanner.siguiente()) {
+                tokens.push_back(t);
+            }
+            procesar(i, scanner, tokens);
+        }
+        scanner.cerrar();
+        errores[i] = mensajes.str();
+    });
+}
+
+// --lexear rutas...: solo el scanner sobre muchos archivos, con --hilos N.
+int lexear_lote(const vector<string>& rutas, int num_hilos) {
+    vector<string> archivos = expandir_rutas(rutas);
+    size_t n = archivos.size();
+    vector<uint32_t> num_tokens(n, 0);
+    vector<size_t> bytes(n, 0);
+    vector<string> errores;
+    vector<char> abierto;
+
+    PoolHilos pool(num_hilos);
+    double ms = medir_ms([&] {
+        lexear_archivos(archivos, pool, errores, abierto, [&](size_t i, const Scanner& scanner, const vector<TokenVista>& tokens) {
+            num_tokens[i] = tokens.size();
+            bytes[i] = scanner.bytes();
+        });
+    });
+
+    size_t tokens = 0, errores_lexicos = 0, con_errores = 0, total_bytes = 0, sin_abrir = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!abierto[i]) {
+            cerr << "Error: no se puede abrir '" << archivos[i] << "'." << endl;
+            ++sin_abrir;
+        }
+        if (!errores[i].empty()) {
+            cerr << archivos[i] << ":\n" << errores[i];
+        }
+        tokens += num_tokens[i];
+        errores_lexicos += count(errores[i].begin(), errores[i].end(), '\n');
+        con_errores += !errores[i].empty();
+        total_bytes += bytes[i];
+    }
+    cout << "Archivos: " << n << ", tokens: " << tokens << ", errores lexicos: " << errores_lexicos
+         << " (en " << con_errores << " archivos)" << endl;
+    cout << "Hilos: " << num_hilos << ", tiempo: " << ms << " ms" << endl;
+    cout << "Rendimiento: " << n / (ms / 1000) << " archivos/s, " << tokens / (ms / 1000) << " tokens/s, "
+         << total_bytes / (ms * 1000) << " MB/s" << endl;
+    return sin_abrir == 0 && errores_lexicos == 0 ? 0 : 1;
+}
+
+// Union scanner -> parser: cada TokenType se traduce una sola vez al terminal de la
+// gramatica con el mismo nombre (Token_type), y los tokens de get_Token_mapeado() se pasan al
+// parser por empuje sin formatearlos como texto. -1 si la gramatica no usa ese token.
+vector<int> terminales_de_tokens(const TablaSimbolos& simbolos) {
+    vector<int> terminal_de(int(TokenType::UNKNOWN) + 1, -1);
+    for (int k = 0; k < int(terminal_de.size()); ++k) {
+        int id = simbolos.id(Token_type(TokenType(k)));
+        if (id >= 0 && simbolos.es_terminal(id)) {
+            terminal_de[k] = id;
+        }
+    }
+    return terminal_de;
+}
+
+// Consume la fuente abierta con mapear_fuente() hasta el fin o el primer error. Devuelve
+// false si aparece un token sin terminal; ultimo queda con el token donde se detuvo.
+template <typename Tabla>
+bool alimentar_desde_scanner(ParserEmpuje<Tabla>& parser, const vector<int>& terminal_de, TokenVista& ultimo,
+                             vector<pair<int, int>>* posiciones = nullptr) {
+    while (true) {
+        ultimo = get_Token_mapeado();
+        if (ultimo.type == TokenType::END_OF_FILE) {
+            parser.terminar();
+            return true;
+        }
+        int id = terminal_de[int(ultimo.type)];
+        if (id < 0) {
+            return false;
+        }
+        if (posiciones) {
+            posiciones->push_back({ultimo.linea, ultimo.columna});
+        }
+        if (!parser.alimentar(id)) {
+            return true;
+        }
     }
+}
 
-    for (const auto& nt : no_terminales) {
-        if (find(goto_order.begin(), goto_order.end(), nt) == goto_order.end())
-            cout << nt << "\t";
+template <typename Tabla>
+bool parse_programa(const string& ruta, const TablaSimbolos& simbolos, const Tabla& tabla, const OpcionesArbol& arbol) {
+    vector<int> terminal_de = terminales_de_tokens(simbolos);
+    if (!mapear_fuente(ruta)) {
+        cerr << "Error: no se puede abrir '" << ruta << "'." << endl;
+        return false;
     }
-    cout << endl;
-    for (size_t i = 0; i < estados.size(); ++i) {
-        cout << i << "\t";
-        for (const auto& t : terminales) {
-            if (action[i].count(t)) cout << action[i][t] << "\t";
-            else cout << "\t";
+    ParserEmpuje<Tabla> parser(tabla);
+    unique_ptr<SesionArbol> sesion;
+    vector<pair<int, int>> posiciones;
+    if (arbol.activo) {
+        sesion.reset(new SesionArbol(tabla, arbol.conservar));
+        parser.construir_arbol(&sesion->constructor);
+    }
+    TokenVista ultimo;
+    bool lexico_ok = alimentar_desde_scanner(parser, terminal_de, ultimo, sesion ? &posiciones : nullptr);
+    const ResultadoParse& r = parser.terminar();
+    if (lexico_ok && r.aceptada) {
+        cout << "Programa aceptado (" << r.pos << " tokens)." << endl;
+        if (sesion) {
+            informar_arbol(*sesion, r.pos, simbolos, &posiciones);
+        }
+        return true;
+    }
+    if (!lexico_ok) {
+        cout << "Programa rechazado (token " << Token_type(ultimo.type) << " sin terminal en la gramatica)." << endl;
+    } else {
+        informar_resultado(r, simbolos);
+    }
+    cout << "Linea " << ultimo.linea << ", columna " << ultimo.columna << ": '" << ultimo.valor << "'" << endl;
+    return false;
+}
+
+// Sentencias de prueba.txt que la gramatica acepta, para generar programas de benchmark.
+const char* const SENTENCIAS_PRUEBA[] = {
+    "paper[1, 1] int = 2 -> numero",
+    "paper[1, 3] boolv = TRUE -> llave",
+    "paper[1, 5] float = 2.2 -> numero2",
+    "paper[2, 1] {if numero < numero2 then llave = FALSE, else llave2 = TRUE}",
+    "paper[2, 4] {from numero to 10 then contador++}",
+    "paper[2, 5] {while llave is TRUE then contador - numero + numero2 , numero++, numero2++, {if contador > 30 then llave = FALSE} , return contador}",
+    "paper[3, 2] {calculate numero + numero2 - contador * contador2 in operacion , return operacion}",
+    "paper[3, 4] {sqrt raicita}",
+};
+
+// Escribe un programa con n sentencias en un archivo temporal y devuelve su ruta.
+string escribir_programa_prueba(const string& nombre, size_t n) {
+    string ruta = (filesystem::temp_directory_path() / nombre).string();
+    ofstream out(ruta);
+    out << "create paper[5, 5]\n";
+    for (size_t i = 0; i < n; ++i) {
+        out << SENTENCIAS_PRUEBA[i % size(SENTENCIAS_PRUEBA)] << "\n";
+    }
+    return ruta;
+}
+
+// Benchmark de extremo a extremo sobre un programa al estilo de prueba.txt con n
+// sentencias: solo el scanner (por flujo y mapeado), scanner y parser unidos, y el camino
+// anterior que pasa los tokens como texto y los vuelve a buscar por nombre.
+int bench_programa(const Gramatica& g, const TablaLR& tabla, size_t n) {
+    string ruta = escribir_programa_prueba("bench_programa.txt", n);
+    vector<int> terminal_de = terminales_de_tokens(g.simbolos);
+    ParserEmpuje<TablaLR> parser(tabla);
+    TokenVista ultimo;
+
+    size_t tokens = 0;
+    double ms_flujo = medir_ms([&] {
+        abrir_fuente(ruta);
+        while (get_Token().type != TokenType::END_OF_FILE) ++tokens;
+    });
+
+    size_t tokens_mapeado = 0;
+    double ms_scanner = medir_ms([&] {
+        mapear_fuente(ruta);
+        while (get_Token_mapeado().type != TokenType::END_OF_FILE) ++tokens_mapeado;
+    });
+
+    bool aceptado_unido = false;
+    double ms_unido = medir_ms([&] {
+        mapear_fuente(ruta);
+        parser.reiniciar();
+        aceptado_unido = alimentar_desde_scanner(parser, terminal_de, ultimo) && parser.terminar().aceptada;
+    });
+
+    bool aceptado_texto = false;
+    double ms_texto = medir_ms([&] {
+        mapear_fuente(ruta);
+        string texto;
+        for (TokenVista t = get_Token_mapeado(); t.type != TokenType::END_OF_FILE; t = get_Token_mapeado()) {
+            texto += Token_type(t.type);
+            texto += ' ';
+        }
+        vector<int> input;
+        stringstream ss(texto);
+        string tok;
+        while (ss >> tok) {
+            input.push_back(g.simbolos.id(tok));
+        }
+        vector<int> pila;
+        aceptado_texto = analizar(tabla, input.data(), input.size(), pila).aceptada;
+    });
+    filesystem::remove(ruta);
+
+    cout << "Sentencias: " << n + 1 << ", tokens: " << tokens << endl;
+    cout << "Scanner (flujo):  " << ms_flujo << " ms (" << tokens / (ms_flujo / 1000) << " tokens/s)" << endl;
+    cout << "Scanner mapeado:  " << ms_scanner << " ms (" << tokens / (ms_scanner / 1000) << " tokens/s)" << endl;
+    cout << "Scanner + parser: " << ms_unido << " ms (" << tokens / (ms_unido / 1000) << " tokens/s)" << endl;
+    cout << "Via texto:        " << ms_texto << " ms (" << tokens / (ms_texto / 1000) << " tokens/s)" << endl;
+    return aceptado_unido && aceptado_texto && tokens_mapeado == tokens ? 0 : 1;
+}
+
+// Variante de escribir_programa_prueba con sangria y comentarios, como las fuentes reales
+// donde dominan los blancos.
+string escribir_programa_sangrado(const string& nombre, size_t n) {
+    string ruta = (filesystem::temp_directory_path() / nombre).string();
+    ofstream out(ruta);
+    out << "create paper[5, 5]\n";
+    for (size_t i = 0; i < n; ++i) {
+        if (i % 4 == 0) {
+            out << "\n        // sentencia " << i << " del programa de prueba, con un comentario largo de linea\n";
+        }
+        if (i % 16 == 0) {
+            out << "        /* bloque " << i << "\n           con varias lineas de texto\n           y sin cerrar hasta aca */\n";
         }
-        for (const auto& nt : goto_order) {
-            if (find(no_terminales.begin(), no_terminales.end(), nt) != no_terminales.end()) {
-                if (goto_table[i].count(nt)) cout << goto_table[i][nt] << "\t";
-                else cout << "\t";
+        out << "        " << SENTENCIAS_PRUEBA[i % size(SENTENCIAS_PRUEBA)] << "\n";
+    }
+    return ruta;
+}
+
+// Cuenta los tokens de ruta con el scanner dado; ms es la mejor de tres pasadas.
+template <typename S>
+size_t contar_tokens(S& scanner, const string& ruta, double& ms) {
+    size_t tokens = 0;
+    ms = 1e300;
+    for (int pasada = 0; pasada < 3; ++pasada) {
+        tokens = 0;
+        scanner.abrir(ruta);
+        ms = min(ms, medir_ms([&] {
+            for (TokenVista tok = scanner.siguiente(); tok.type != TokenType::END_OF_FILE; tok = scanner.siguiente()) {
+                ++tokens;
+            }
+        }));
+        scanner.cerrar();
+    }
+    return tokens;
+}
+
+// --bench-scanner: el scanner por flujo, el mapeado con cada juego de nucleos que la CPU
+// soporta y el AFD de tokens.txt sobre dos programas de prueba, uno compacto y otro con
+// sangria y comentarios. Comprueba que el AFD y todas las versiones del mapeado dan los
+// mismos tokens.
+int bench_scanner(const TablasScanner& t, size_t n) {
+    cout << "AFD: " << t.num_estados << " estados, " << t.num_clases << " clases de bytes, "
+         << t.transicion.size() * sizeof(uint16_t) + sizeof(t.clase) << " bytes de tablas" << endl;
+    bool ok = true;
+    for (int sangrado = 0; sangrado < 2; ++sangrado) {
+        string ruta = sangrado ? escribir_programa_sangrado("bench_scanner.txt", n) : escribir_programa_prueba("bench_scanner.txt", n);
+        size_t bytes = filesystem::file_size(ruta);
+
+        size_t tokens = 0;
+        double ms_flujo = medir_ms([&] {
+            abrir_fuente(ruta);
+            while (get_Token().type != TokenType::END_OF_FILE) ++tokens;
+        });
+        cout << (sangrado ? "Programa con sangria y comentarios" : "Programa compacto") << ": " << n + 1
+             << " sentencias, " << tokens << " tokens, " << bytes << " bytes" << endl;
+        auto linea = [&](const string& nombre, double ms) {
+            cout << "  " << left << setw(27) << nombre << right << ms << " ms (" << tokens / (ms / 1000) << " tokens/s, "
+                 << bytes / (ms * 1000) << " MB/s)" << endl;
+        };
+        linea("Scanner (flujo):", ms_flujo);
+
+        vector<vector<TokenVista>> salidas;
+        auto recoger = [&](auto& scanner) {
+            salidas.emplace_back();
+            scanner.abrir(ruta);
+            for (TokenVista tok = scanner.siguiente(); tok.type != TokenType::END_OF_FILE; tok = scanner.siguiente()) {
+                salidas.back().push_back(tok);
             }
+        };
+        vector<unique_ptr<Scanner>> mapeados;
+        for (const KernelsLexicos* k : kernels_disponibles()) {
+            mapeados.push_back(make_unique<Scanner>());
+            mapeados.back()->kernels = k;
+            double ms;
+            ok = contar_tokens(*mapeados.back(), ruta, ms) == tokens && ok;
+            linea(string("Scanner mapeado (") + k->nombre + "):", ms);
+            recoger(*mapeados.back());
         }
-        for (const auto& nt : no_terminales) {
-            if (find(goto_order.begin(), goto_order.end(), nt) == goto_order.end()) {
-                if (goto_table[i].count(nt)) cout << goto_table[i][nt] << "\t";
-                else cout << "\t";
+        ScannerDFA afd(t);
+        double ms_afd;
+        ok = contar_tokens(afd, ruta, ms_afd) == tokens && ok;
+        linea("Scanner AFD:", ms_afd);
+        recoger(afd);
+
+        for (size_t s = 1; s < salidas.size(); ++s) {
+            const vector<TokenVista>& a = salidas[0];
+            const vector<TokenVista>& b = salidas[s];
+            for (size_t i = 0; i < max(a.size(), b.size()); ++i) {
+                if (i >= a.size() || i >= b.size() || a[i].type != b[i].type || a[i].valor != b[i].valor ||
+                    a[i].linea != b[i].linea || a[i].columna != b[i].columna) {
+                    cerr << "Error: el scanner " << s << " difiere del mapeado en el token " << i << "." << endl;
+                    ok = false;
+                    break;
+                }
             }
         }
-        cout << endl;
+        filesystem::remove(ruta);
     }
+    return ok ? 0 : 1;
+}
 
-    cout << "\nIngrese la cadena: ";
-    string input_line;
-    getline(cin, input_line);
-    stringstream ss(input_line);
-    vector<string> input;
-    string tok;
-    while (ss >> tok) {
-        input.push_back(tok);
+// Reanalisis incremental al estilo de Wagner y Graham. Se conserva el arbol anterior con,
+// en cada nodo, el estado LR sobre el que se apilo. Al cambiar la entrada, los tokens se
+// comparan con los anteriores para hallar el prefijo y el sufijo comunes. El bucle
+// shift/reduce de siempre corre sobre la entrada nueva, pero antes de desplazar un
+// terminal intenta desplazar de una vez el mayor subarbol viejo que empieza ahi. El
+// subarbol se reutiliza si sus tokens y el token siguiente quedaron fuera de la edicion,
+// y si su estado previo coincide con la cima de la pila. Por el determinismo de LR, ese
+// subarbol es exactamente lo que el parser reconstruiria.
+//
+// Las listas recursivas por la izquierda (A -> A b) no se guardan como una espina con un
+// nodo por elemento, que habria que rehacer entera despues de cada edicion. Cada
+// reduccion A -> A b deja un ELEMENTO con los hijos b, y la cabeza (A -> g) queda como un
+// nodo SIMPLE. Al cerrarse la lista, sus elementos cuelgan de un treap de nodos LISTA (si
+// el tramo incluye la cabeza) o COLA (si no), con prioridades fijas por elemento. Un tramo
+// COLA o un ELEMENTO viejo se agrega a la lista de la cima si esta tiene el mismo simbolo y
+// el mismo estado debajo: los elementos se analizan siempre desde ir_a(previo, A) y
+// vuelven a el. Asi una edicion reutiliza la lista en O(log n) tramos.
+enum class TipoNodo : uint8_t {
+    SIMPLE,    // terminal o reduccion comun
+    ELEMENTO,  // A -> A b: los hijos son b
+    LISTA,     // tramo de lista con su cabeza: hijos (LISTA izquierda), elemento, (COLA derecha)
+    COLA,      // tramo de lista sin cabeza: hijos (COLA izquierda), elemento, (COLA derecha)
+};
+
+struct NodoIncremental {
+    int32_t simbolo;
+    int32_t estado_previo;  // en listas, el estado debajo de la lista
+    uint32_t num_tokens;
+    uint32_t primer_hijo;   // indice en hijos; en LISTA y COLA la prioridad va detras de ellos
+    uint32_t num_hijos : 30;
+    TipoNodo tipo : 2;
+};
+
+struct ResultadoIncremental {
+    bool aceptada;
+    size_t pos;                  // tokens consumidos
+    size_t subarboles_reusados;
+    size_t tokens_reusados;
+    size_t nodos_nuevos;
+};
+
+template <typename Tabla>
+class ParserIncremental {
+public:
+    explicit ParserIncremental(const Tabla& tabla) : tabla(tabla) {}
+
+    // Si la entrada se rechaza, se conserva el ultimo arbol aceptado.
+    ResultadoIncremental reanalizar(const vector<int>& tokens) {
+        size_t n_viejo = tokens_previos.size(), n = tokens.size();
+        if (raiz >= 0 && tokens_conocidos && tokens == tokens_previos) {
+            return {true, n, 1, n, 0};
+        }
+        size_t prefijo = 0, sufijo = 0;
+        if (raiz >= 0 && tokens_conocidos) {
+            while (prefijo < n_viejo && prefijo < n && tokens_previos[prefijo] == tokens[prefijo]) ++prefijo;
+            while (sufijo < n_viejo - prefijo && sufijo < n - prefijo
+                   && tokens_previos[n_viejo - 1 - sufijo] == tokens[n - 1 - sufijo]) ++sufijo;
+        }
+        ResultadoIncremental r = reanalizar(tokens, prefijo, sufijo);
+        if (r.aceptada) {
+            tokens_previos = tokens;
+            tokens_conocidos = true;
+        }
+        return r;
+    }
+
+    // Igual, pero con la edicion ya conocida: los primeros prefijo tokens y los ultimos
+    // sufijo son los de la version anterior. No recorre la entrada entera para compararla,
+    // asi que el costo depende de la edicion y no del largo del archivo.
+    ResultadoIncremental reanalizar(const vector<int>& tokens, size_t prefijo, size_t sufijo) {
+        size_t n = tokens.size();
+        size_t n_viejo = raiz >= 0 ? nodos[raiz].num_tokens : 0;
+        prefijo = min({prefijo, n, n_viejo});
+        sufijo = min({sufijo, n - prefijo, n_viejo - prefijo});
+        edicion = {prefijo, n_viejo - sufijo, n - sufijo};
+        marcos.clear();
+        if (raiz >= 0) {
+            marcos.push_back({raiz, 0, 0, 0});
+        }
+        abiertas.clear();
+
+        ResultadoIncremental r = {false, 0, 0, 0, 0};
+        size_t nodos_al_inicio = nodos.size();
+        auto terminar = [&](size_t pos) {
+            r.pos = pos;
+            r.nodos_nuevos = nodos.size() - nodos_al_inicio;
+            return r;
+        };
+        pila.clear();
+        pila.push_back({0, -1});
+        size_t pos = 0;
+        while (true) {
+            int estado = pila.back().first;
+            int word = (pos < n) ? tokens[pos] : tabla.fin;
+            uint32_t act = tabla.accion(estado, word);
+            switch (tipo_accion(act)) {
+                case TipoAccion::SHIFT: {
+                    int reusado = buscar_reutilizable(pos, estado);
+                    if (reusado >= 0) {
+                        const NodoIncremental& nodo = nodos[reusado];
+                        if (es_continuacion(nodo)) {
+                            extender(pila.size() - 1, reusado);
+                        } else {
+                            pila.push_back({tabla.ir_a(estado, nodo.simbolo - tabla.num_terminales), reusado});
+                        }
+                        pos += nodo.num_tokens;
+                        ++r.subarboles_reusados;
+                        r.tokens_reusados += nodo.num_tokens;
+                        break;
+                    }
+                    nodos.push_back(NodoIncremental{word, estado, 1, 0, 0, TipoNodo::SIMPLE});
+                    pila.push_back({int(destino_accion(act)), int(nodos.size() - 1)});
+                    ++pos;
+                    break;
+                }
+                case TipoAccion::REDUCE: {
+                    uint32_t prod = destino_accion(act);
+                    int len = tabla.prod_len[prod];
+                    if (size_t(len) >= pila.size()) {
+                        return terminar(pos);
+                    }
+                    size_t inicio = pila.size() - len;
+                    int32_t simbolo = tabla.prod_izq[prod] + tabla.num_terminales;
+                    // A -> A b: el A de la pila sigue siendo la lista y b pasa a ser un elemento.
+                    bool es_lista = len >= 2 && nodos[pila[inicio].second].simbolo == simbolo;
+                    cerrar_listas(es_lista ? inicio + 1 : inicio);
+                    uint32_t primer_hijo = hijos.size();
+                    uint32_t num_tokens = 0;
+                    for (size_t i = es_lista ? inicio + 1 : inicio; i < pila.size(); ++i) {
+                        hijos.push_back(pila[i].second);
+                        num_tokens += nodos[pila[i].second].num_tokens;
+                    }
+                    if (es_lista) {
+                        nodos.push_back(NodoIncremental{simbolo, pila[inicio - 1].first, num_tokens, primer_hijo,
+                                                        uint32_t(len - 1), TipoNodo::ELEMENTO});
+                        pila.resize(inicio + 1);
+                        extender(inicio, nodos.size() - 1);
+                        break;
+                    }
+                    pila.resize(inicio);
+                    int previo = pila.back().first;
+                    int siguiente = tabla.ir_a(previo, tabla.prod_izq[prod]);
+                    if (siguiente < 0) {
+                        return terminar(pos);
+                    }
+                    nodos.push_back(NodoIncremental{simbolo, previo, num_tokens, primer_hijo, uint32_t(len), TipoNodo::SIMPLE});
+                    pila.push_back({siguiente, int(nodos.size() - 1)});
+                    break;
+                }
+                case TipoAccion::ACCEPT: {
+                    // La produccion 0 no se reduce: la raiz cuelga de la pila entera.
+                    cerrar_listas(1);
+                    uint32_t primer_hijo = hijos.size();
+                    for (size_t i = 1; i < pila.size(); ++i) {
+                        hijos.push_back(pila[i].second);
+                    }
+                    nodos.push_back(NodoIncremental{tabla.prod_izq[0] + tabla.num_terminales, 0, uint32_t(n), primer_hijo,
+                                                    uint32_t(pila.size() - 1), TipoNodo::SIMPLE});
+                    raiz = nodos.size() - 1;
+                    tokens_conocidos = false;
+                    r.aceptada = true;
+                    terminar(pos);
+                    if (nodos.size() > 8 * (n + 1) + 1024) {
+                        compactar();
+                    }
+                    return r;
+                }
+                default:
+                    return terminar(pos);
+            }
+        }
+    }
+
+    int raiz_actual() const {
+        return raiz;
+    }
+
+    const NodoIncremental& nodo(int id) const {
+        return nodos[id];
+    }
+
+    const int32_t* hijos_de(int id) const {
+        return hijos.data() + nodos[id].primer_hijo;
+    }
+
+private:
+    struct Edicion {
+        size_t prefijo;      // tokens iguales al principio
+        size_t fin_viejo;    // el sufijo comun empieza aqui en la entrada vieja
+        size_t fin_nuevo;    // ... y aqui en la nueva
+    };
+
+    // Recorrido del arbol viejo: camino desde la raiz hasta el nodo actual, con el
+    // siguiente hijo a visitar de cada uno y la posicion donde empieza ese hijo.
+    struct Marco {
+        int nodo;
+        size_t inicio;
+        uint32_t hijo;
+        size_t inicio_hijo;
+    };
+
+    // Lista que sigue creciendo en la pila: sus tramos en orden, el primero con la cabeza.
+    // Se arma el treap recien cuando otra reduccion la consume. Las listas abiertas se
+    // anidan como la pila, asi que sus tramos comparten un solo arreglo.
+    struct ListaAbierta {
+        size_t nivel;         // indice en pila
+        size_t primer_tramo;  // indice en tramos_abiertos
+    };
+
+    // Elemento en la cadena derecha de treap_de, con su subarbol izquierdo ya creado.
+    struct EnCadena {
+        int elemento;
+        uint32_t prioridad;
+        int izq;
+    };
+
+    const Tabla& tabla;
+    vector<NodoIncremental> nodos;
+    vector<int32_t> hijos;
+    int raiz = -1;
+    vector<int> tokens_previos;
+    bool tokens_conocidos = false;  // tokens_previos corresponde a raiz
+    Edicion edicion;
+    vector<Marco> marcos;
+    vector<pair<int, int>> pila;  // (estado, nodo); en una lista abierta, su primer tramo
+    vector<ListaAbierta> abiertas;
+    vector<int> tramos_abiertos;
+    vector<EnCadena> cadena;  // auxiliar de treap_de
+
+    static bool es_continuacion(const NodoIncremental& nodo) {
+        return nodo.tipo == TipoNodo::ELEMENTO || nodo.tipo == TipoNodo::COLA;
+    }
+
+    static bool es_tramo(const NodoIncremental& nodo) {
+        return nodo.tipo == TipoNodo::LISTA || nodo.tipo == TipoNodo::COLA;
+    }
+
+    uint32_t prioridad(int tramo) const {
+        return uint32_t(hijos[nodos[tramo].primer_hijo + nodos[tramo].num_hijos]);
+    }
+
+    bool fuera_de_la_edicion(size_t inicio, size_t num_tokens) const {
+        // Tambien el token siguiente, que fue el lookahead de la ultima reduccion.
+        return inicio + num_tokens < edicion.prefijo || inicio >= edicion.fin_viejo;
+    }
+
+    // Un nodo completo se apila sobre su estado previo. Una continuacion de lista se agrega
+    // a la cima si esta es una lista del mismo simbolo apilada sobre el mismo estado.
+    bool encaja(const NodoIncremental& nodo, int estado) const {
+        if (es_continuacion(nodo)) {
+            return pila.size() >= 2 && nodos[pila.back().second].simbolo == nodo.simbolo
+                   && pila[pila.size() - 2].first == nodo.estado_previo;
+        }
+        return nodo.estado_previo == estado && tabla.ir_a(estado, nodo.simbolo - tabla.num_terminales) >= 0;
+    }
+
+    int buscar_reutilizable(size_t pos, int estado) {
+        size_t viejo;
+        if (pos < edicion.prefijo) {
+            viejo = pos;
+        } else if (pos >= edicion.fin_nuevo) {
+            viejo = pos - edicion.fin_nuevo + edicion.fin_viejo;
+        } else {
+            return -1;
+        }
+        while (!marcos.empty() && marcos.back().inicio + nodos[marcos.back().nodo].num_tokens <= viejo) {
+            marcos.pop_back();
+        }
+        while (!marcos.empty()) {
+            Marco& m = marcos.back();
+            const NodoIncremental& nodo = nodos[m.nodo];
+            if (m.inicio == viejo) {
+                if (nodo.num_hijos == 0 && nodo.simbolo < tabla.num_terminales) {
+                    return -1;
+                }
+                if (fuera_de_la_edicion(viejo, nodo.num_tokens) && encaja(nodo, estado)) {
+                    int id = m.nodo;
+                    marcos.pop_back();
+                    return id;
+                }
+            }
+            // Bajar al hijo que contiene la posicion vieja.
+            bool bajo = false;
+            while (m.hijo < nodo.num_hijos) {
+                int c = hijos[nodo.primer_hijo + m.hijo];
+                size_t inicio_c = m.inicio_hijo;
+                ++m.hijo;
+                m.inicio_hijo += nodos[c].num_tokens;
+                if (nodos[c].num_tokens > 0 && inicio_c + nodos[c].num_tokens > viejo) {
+                    marcos.push_back({c, inicio_c, 0, inicio_c});
+                    bajo = true;
+                    break;
+                }
+            }
+            if (!bajo) {
+                return -1;
+            }
+        }
+        return -1;
+    }
+
+    void extender(size_t nivel, int tramo) {
+        if (abiertas.empty() || abiertas.back().nivel != nivel) {
+            abiertas.push_back({nivel, tramos_abiertos.size()});
+            tramos_abiertos.push_back(pila[nivel].second);
+        }
+        tramos_abiertos.push_back(tramo);
+    }
+
+    // Arma las listas abiertas desde el nivel dado hasta la cima y deja sus raices en la pila.
+    void cerrar_listas(size_t nivel) {
+        while (!abiertas.empty() && abiertas.back().nivel >= nivel) {
+            size_t primero = abiertas.back().primer_tramo;
+            pila[abiertas.back().nivel].second = armar_lista(primero, tramos_abiertos.size());
+            tramos_abiertos.resize(primero);
+            abiertas.pop_back();
+        }
+    }
+
+    // Los elementos sueltos seguidos se arman en un solo treap, en tiempo lineal; los tramos
+    // viejos se unen de a uno, copiando solo el camino que cambia.
+    int armar_lista(size_t desde, size_t hasta) {
+        int lista = -1;
+        size_t sueltos = desde;
+        for (size_t i = desde; i < hasta; ++i) {
+            int t = tramos_abiertos[i];
+            if (es_tramo(nodos[t])) {
+                lista = unir(lista, treap_de(sueltos, i));
+                lista = unir(lista, t);
+                sueltos = i + 1;
+            }
+        }
+        return unir(lista, treap_de(sueltos, hasta));
+    }
+
+    // Prioridad de un elemento, fija mientras conserve su indice.
+    static uint32_t prioridad_de(int elemento) {
+        uint32_t x = uint32_t(elemento);
+        x ^= x >> 16;
+        x *= 0x7feb352d;
+        x ^= x >> 15;
+        x *= 0x846ca68b;
+        x ^= x >> 16;
+        return x;
+    }
+
+    int nuevo_tramo(int izq, int elemento, int der, uint32_t prioridad) {
+        uint32_t primer_hijo = hijos.size(), num_hijos = 0, num_tokens = 0;
+        for (int c : {izq, elemento, der}) {
+            if (c >= 0) {
+                hijos.push_back(c);
+                ++num_hijos;
+                num_tokens += nodos[c].num_tokens;
+            }
+        }
+        hijos.push_back(int32_t(prioridad));
+        bool con_cabeza = izq >= 0 ? nodos[izq].tipo == TipoNodo::LISTA : nodos[elemento].tipo == TipoNodo::SIMPLE;
+        nodos.push_back(NodoIncremental{nodos[elemento].simbolo, nodos[elemento].estado_previo, num_tokens, primer_hijo,
+                                        num_hijos, con_cabeza ? TipoNodo::LISTA : TipoNodo::COLA});
+        return nodos.size() - 1;
     }
 
-    parse_string(input, producciones, action, goto_table);
+    // (izquierda, elemento, derecha) de un tramo; -1 donde no hay subarbol.
+    array<int, 3> partes(int tramo) const {
+        array<int, 3> p = {-1, -1, -1};
+        const int32_t* h = hijos.data() + nodos[tramo].primer_hijo;
+        for (uint32_t i = 0; i < nodos[tramo].num_hijos; ++i) {
+            if (es_tramo(nodos[h[i]])) {
+                p[p[1] < 0 ? 0 : 2] = h[i];
+            } else {
+                p[1] = h[i];
+            }
+        }
+        return p;
+    }
+
+    // Arbol cartesiano de los elementos tramos_abiertos[desde, hasta) por prioridad. Se
+    // mantiene la cadena derecha; cada elemento que sale de ella ya tiene sus dos subarboles
+    // y se crea en ese momento.
+    int treap_de(size_t desde, size_t hasta) {
+        cadena.clear();
+        for (size_t i = desde; i < hasta; ++i) {
+            uint32_t p = prioridad_de(tramos_abiertos[i]);
+            int izq = -1;
+            while (!cadena.empty() && cadena.back().prioridad < p) {
+                izq = nuevo_tramo(cadena.back().izq, cadena.back().elemento, izq, cadena.back().prioridad);
+                cadena.pop_back();
+            }
+            cadena.push_back({tramos_abiertos[i], p, izq});
+        }
+        int der = -1;
+        while (!cadena.empty()) {
+            der = nuevo_tramo(cadena.back().izq, cadena.back().elemento, der, cadena.back().prioridad);
+            cadena.pop_back();
+        }
+        return der;
+    }
+
+    // Union persistente de dos treaps: los nodos viejos no se tocan.
+    int unir(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (prioridad(a) >= prioridad(b)) {
+            array<int, 3> p = partes(a);
+            return nuevo_tramo(p[0], p[1], unir(p[2], b), prioridad(a));
+        }
+        array<int, 3> p = partes(b);
+        return nuevo_tramo(unir(a, p[0]), p[1], p[2], prioridad(b));
+    }
+
+    // Copia el arbol vivo a arreglos nuevos y descarta los nodos de versiones anteriores.
+    void compactar() {
+        vector<NodoIncremental> nuevos;
+        vector<int32_t> nuevos_hijos;
+        vector<pair<int, int>> pendientes = {{raiz, -1}};  // (nodo viejo, posicion en nuevos_hijos)
+        nuevos.reserve(nodos.size() / 4);
+        while (!pendientes.empty()) {
+            auto [viejo, destino] = pendientes.back();
+            pendientes.pop_back();
+            NodoIncremental nodo = nodos[viejo];
+            uint32_t primer = nuevos_hijos.size();
+            nuevos_hijos.resize(primer + nodo.num_hijos);
+            for (uint32_t i = 0; i < nodo.num_hijos; ++i) {
+                pendientes.push_back({hijos[nodo.primer_hijo + i], int(primer + i)});
+            }
+            if (es_tramo(nodo)) {
+                nuevos_hijos.push_back(hijos[nodo.primer_hijo + nodo.num_hijos]);
+            }
+            nodo.primer_hijo = primer;
+            nuevos.push_back(nodo);
+            if (destino >= 0) {
+                nuevos_hijos[destino] = nuevos.size() - 1;
+            }
+        }
+        nodos.swap(nuevos);
+        hijos.swap(nuevos_hijos);
+        raiz = 0;
+    }
+};
+
+// Lee la fuente abierta con mapear_fuente() entera como terminales con sus posiciones. Devuelve false si aparece un
+// token sin terminal en la gramatica; ultimo queda con ese token.
+bool tokens_de_programa(const vector<int>& terminal_de, vector<int>& tokens,
+                        vector<pair<int, int>>& posiciones, TokenVista& ultimo) {
+    tokens.clear();
+    posiciones.clear();
+    for (ultimo = get_Token_mapeado(); ultimo.type != TokenType::END_OF_FILE; ultimo = get_Token_mapeado()) {
+        int id = terminal_de[int(ultimo.type)];
+        if (id < 0) {
+            return false;
+        }
+        tokens.push_back(id);
+        posiciones.push_back({ultimo.linea, ultimo.columna});
+    }
+    return true;
+}
+
+// Analiza cada archivo como una nueva version del anterior, reutilizando su arbol.
+template <typename Tabla>
+int parse_incremental(const vector<string>& rutas, const TablaSimbolos& simbolos, const Tabla& tabla) {
+    vector<int> terminal_de = terminales_de_tokens(simbolos);
+    ParserIncremental<Tabla> parser(tabla);
+    vector<int> tokens;
+    vector<pair<int, int>> posiciones;
+    int errores = 0;
+    for (const string& ruta : rutas) {
+        if (!mapear_fuente(ruta)) {
+            cerr << "Error: no se puede abrir '" << ruta << "'." << endl;
+            ++errores;
+            continue;
+        }
+        TokenVista ultimo;
+        if (!tokens_de_programa(terminal_de, tokens, posiciones, ultimo)) {
+            cout << ruta << ": rechazado (token " << Token_type(ultimo.type) << " sin terminal en la gramatica, linea "
+                 << ultimo.linea << ", columna " << ultimo.columna << ")." << endl;
+            ++errores;
+            continue;
+        }
+        ResultadoIncremental r;
+        double ms = medir_ms([&] { r = parser.reanalizar(tokens); });
+        if (r.aceptada) {
+            cout << ruta << ": aceptado (" << tokens.size() << " tokens, " << r.tokens_reusados << " reutilizados en "
+                 << r.subarboles_reusados << " subarboles, " << r.nodos_nuevos << " nodos nuevos, " << ms << " ms)." << endl;
+            continue;
+        }
+        ++errores;
+        cout << ruta << ": rechazado";
+        if (r.pos < posiciones.size()) {
+            cout << " en linea " << posiciones[r.pos].first << ", columna " << posiciones[r.pos].second
+                 << " (" << simbolos.nombre(tokens[r.pos]) << ")";
+        } else {
+            cout << " al final de la entrada";
+        }
+        cout << "; se conserva el arbol anterior." << endl;
+    }
+    return errores == 0 ? 0 : 1;
+}
+
+// Benchmark del reanalisis: un programa de n sentencias se analiza una vez completo y
+// luego se reemplaza una sentencia por otra en distintas posiciones, reanalizando cada vez.
+int bench_incremental(const Gramatica& g, const TablaLR& tabla, size_t n) {
+    string ruta = escribir_programa_prueba("bench_incremental.txt", n);
+    vector<int> terminal_de = terminales_de_tokens(g.simbolos);
+    vector<int> tokens;
+    vector<pair<int, int>> posiciones;
+    TokenVista ultimo;
+    mapear_fuente(ruta);
+    bool lexico_ok = tokens_de_programa(terminal_de, tokens, posiciones, ultimo);
+    filesystem::remove(ruta);
+    int paper = g.simbolos.id(Token_type(TokenType::PAPER));
+    int create = g.simbolos.id(Token_type(TokenType::CREATE));
+    if (!lexico_ok || paper < 0) {
+        cerr << "Error: la gramatica no reconoce el programa de prueba." << endl;
+        return 1;
+    }
+
+    // Cada sentencia empieza en un PAPER que no sigue a CREATE.
+    vector<size_t> inicios;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i] == paper && (i == 0 || tokens[i - 1] != create)) {
+            inicios.push_back(i);
+        }
+    }
+    inicios.push_back(tokens.size());
+    size_t num_sentencias = inicios.size() - 1;
+
+    ParserIncremental<TablaLR> parser(tabla);
+    ResultadoIncremental r;
+    double ms_completo = medir_ms([&] { r = parser.reanalizar(tokens); });
+    if (!r.aceptada) {
+        cerr << "Error: el programa de prueba fue rechazado." << endl;
+        return 1;
+    }
+    vector<int> pila;
+    double ms_lineal = medir_ms([&] { analizar(tabla, tokens.data(), tokens.size(), pila); });
+
+    // Las mismas ediciones se reanalizan con la edicion conocida, como lo haria un editor,
+    // y despues comparando los tokens contra la version anterior.
+    const int EDICIONES = 200;
+    mt19937 rng(7);
+    vector<pair<size_t, size_t>> ediciones;  // (sentencia reemplazada, sentencia nueva)
+    for (int e = 0; e < EDICIONES; ++e) {
+        size_t k = rng() % num_sentencias;
+        ediciones.push_back({k, rng() % num_sentencias});
+    }
+    double ms_ediciones = 0, ms_comparando = 0;
+    size_t tokens_reusados = 0, nodos_nuevos = 0;
+    bool todas_aceptadas = true;
+    vector<int> editado;
+    for (bool comparando : {false, true}) {
+        if (comparando) {
+            parser.reanalizar(tokens);  // la version anterior tiene que tener sus tokens guardados
+        }
+        for (auto [k, j] : ediciones) {
+            editado.assign(tokens.begin(), tokens.begin() + inicios[k]);
+            editado.insert(editado.end(), tokens.begin() + inicios[j], tokens.begin() + inicios[j + 1]);
+            editado.insert(editado.end(), tokens.begin() + inicios[k + 1], tokens.end());
+            size_t prefijo = inicios[k], sufijo = tokens.size() - inicios[k + 1];
+            // Y vuelta a la version original para que la siguiente edicion parta de ella.
+            for (const vector<int>* version : {&editado, &tokens}) {
+                if (comparando) {
+                    ms_comparando += medir_ms([&] { r = parser.reanalizar(*version); });
+                } else {
+                    ms_ediciones += medir_ms([&] { r = parser.reanalizar(*version, prefijo, sufijo); });
+                    tokens_reusados += r.tokens_reusados;
+                    nodos_nuevos += r.nodos_nuevos;
+                }
+                todas_aceptadas = todas_aceptadas && r.aceptada;
+            }
+        }
+    }
+
+    cout << "Sentencias: " << num_sentencias << ", tokens: " << tokens.size() << endl;
+    cout << "Analisis completo con arbol: " << ms_completo << " ms" << endl;
+    cout << "Analisis completo sin arbol: " << ms_lineal << " ms" << endl;
+    cout << "Reanalisis tras una edicion: " << ms_ediciones / (2 * EDICIONES) << " ms en promedio ("
+         << tokens_reusados / (2 * EDICIONES) << " tokens reutilizados, "
+         << nodos_nuevos / (2 * EDICIONES) << " nodos nuevos)" << endl;
+    cout << "Reanalisis comparando los tokens: " << ms_comparando / (2 * EDICIONES) << " ms en promedio" << endl;
+    return todas_aceptadas ? 0 : 1;
+}
+
+// Reporte de --stats por stderr, como texto o como JSON.
+void imprimir_estadisticas(bool json, size_t num_estados) {
+    const EstadisticasConstruccion& e = estadisticas;
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    long memoria_kb = uso.ru_maxrss;
+    uint64_t busquedas = e.busquedas_nucleo, repetidos = e.nucleos_repetidos;
+    uint64_t consultas = e.consultas_celda, calculadas = e.celdas_calculadas;
+    double aciertos_nucleo = busquedas ? 100.0 * repetidos / busquedas : 0;
+    double aciertos_celda = consultas ? 100.0 * (consultas - calculadas) / consultas : 0;
+    ostringstream out;
+    out << fixed << setprecision(3);
+    if (json) {
+        out << "{\"fases_ms\": {";
+        for (size_t i = 0; i < e.fases.size(); ++i) {
+            string clave = e.fases[i].first;
+            replace(clave.begin(), clave.end(), ' ', '_');
+            out << (i ? ", " : "") << "\"" << clave << "\": " << e.fases[i].second;
+        }
+        out << "}, \"cierre\": {\"llamadas\": " << e.llamadas_cierre << ", \"items\": " << e.items_cierre
+            << ", \"ms\": " << e.ns_cierre / 1e6 << "}";
+        out << ", \"goto\": {\"llamadas\": " << e.llamadas_goto << ", \"items\": " << e.items_goto
+            << ", \"ms\": " << e.ns_goto / 1e6 << "}";
+        out << ", \"estados\": " << num_estados << ", \"busquedas_nucleo\": " << busquedas
+            << ", \"nucleos_repetidos\": " << repetidos << ", \"aciertos_memo\": " << aciertos_nucleo / 100;
+        if (consultas) {
+            out << ", \"celdas\": {\"consultas\": " << consultas << ", \"calculadas\": " << calculadas
+                << ", \"aciertos\": " << aciertos_celda / 100 << "}";
+        }
+        out << ", \"memoria_pico_kb\": " << memoria_kb << "}\n";
+    } else {
+        out << "Estadisticas de construccion:\n";
+        for (const auto& [nombre, ms] : e.fases) {
+            out << "  " << left << setw(26) << nombre << right << setw(10) << ms << " ms\n";
+        }
+        out << "  Cierres: " << e.llamadas_cierre << " llamadas, " << e.items_cierre << " items, "
+            << e.ns_cierre / 1e6 << " ms\n";
+        out << "  Goto: " << e.llamadas_goto << " llamadas, " << e.items_goto << " items de nucleo, "
+            << e.ns_goto / 1e6 << " ms\n";
+        out << "  Estados: " << num_estados << " (" << busquedas << " busquedas de nucleo, " << repetidos
+            << " repetidos, " << setprecision(1) << aciertos_nucleo << "% de aciertos en el memo)\n";
+        if (consultas) {
+            out << "  Celdas perezosas: " << consultas << " consultas, " << calculadas << " calculadas ("
+                << aciertos_celda << "% de aciertos)\n";
+        }
+        out << "  Memoria pico: " << memoria_kb << " KB\n";
+    }
+    cerr << out.str();
+}
+
+// Argumento opcional de cantidad: se consume argv[i + 1] solo si es un numero, asi que
+// "--bench-parse --stats" usa el valor por defecto en vez de leer el flag siguiente.
+size_t cantidad_opcional(int argc, char* argv[], int& i, size_t por_defecto) {
+    if (i + 1 >= argc) {
+        return por_defecto;
+    }
+    string siguiente = argv[i + 1];
+    if (siguiente.empty() || siguiente.find_first_not_of("0123456789") != string::npos) {
+        return por_defecto;
+    }
+    ++i;
+    // Un numero que no cabe en size_t se descarta en vez de abortar el programa.
+    try {
+        unsigned long long valor = stoull(siguiente);
+        if (valor <= SIZE_MAX) {
+            return size_t(valor);
+        }
+    } catch (const out_of_range&) {
+    }
+    cerr << "Aviso: cantidad '" << siguiente << "' fuera de rango; se usa " << por_defecto << "." << endl;
+    return por_defecto;
+}
+
+int main(int argc, char* argv[]) {
+    string archivo_gramatica = "gramatica.txt";
+    string modo = "lr1";
+    bool comparar = false;
+    size_t bench_tokens = 0;
+    int hilos = 1;
+    bool usar_comprimida = false;
+    bool reportar_tamano = false;
+    bool gramatica_explicita = false;
+    string tabla_salida, tabla_entrada;
+    string prefijo_cpp;
+    bool directo = false;
+    bool perezosa = false;
+    string ruta_lote;
+    bool flujo = false;
+    string ruta_programa;
+    size_t bench_sentencias = 0;
+    OpcionesArbol arbol;
+    string solo_arbol;
+    bool glr = false;
+    string ruta_cache;
+    vector<string> rutas_incrementales;
+    vector<string> rutas_lexear;
+    string ruta_tokens = "tokens.txt";
+    string prefijo_scanner;
+    size_t bench_scanner_sentencias = 0;
+    size_t bench_incremental_sentencias = 0;
+    string volcado_salida, volcado_entrada;
+    bool stats_json = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--bench-closure") {
+            int n = cantidad_opcional(argc, argv, i, 100);
+            return bench_closure(n);
+        } else if (arg == "--gramatica" && i + 1 < argc) {
+            archivo_gramatica = argv[++i];
+            gramatica_explicita = true;
+        } else if (arg == "--generar-tabla" && i + 1 < argc) {
+            tabla_salida = argv[++i];
+        } else if (arg == "--generar-cpp" && i + 1 < argc) {
+            prefijo_cpp = argv[++i];
+        } else if (arg == "--directo") {
+            directo = true;
+        } else if (arg == "--lote" && i + 1 < argc) {
+            ruta_lote = argv[++i];
+        } else if (arg == "--programa" && i + 1 < argc) {
+            ruta_programa = argv[++i];
+        } else if (arg == "--bench-programa") {
+            bench_sentencias = cantidad_opcional(argc, argv, i, 100000);
+        } else if (arg == "--incremental") {
+            while (i + 1 < argc && string(argv[i + 1]).rfind("--", 0) != 0) {
+                rutas_incrementales.push_back(argv[++i]);
+            }
+        } else if (arg == "--lexear") {
+            while (i + 1 < argc && string(argv[i + 1]).rfind("--", 0) != 0) {
+                rutas_lexear.push_back(argv[++i]);
+            }
+        } else if (arg == "--tokens" && i + 1 < argc) {
+            ruta_tokens = argv[++i];
+        } else if (arg == "--generar-scanner" && i + 1 < argc) {
+            prefijo_scanner = argv[++i];
+        } else if (arg == "--bench-scanner") {
+            bench_scanner_sentencias = cantidad_opcional(argc, argv, i, 100000);
+        } else if (arg == "--bench-incremental") {
+            bench_incremental_sentencias = cantidad_opcional(argc, argv, i, 100000);
+        } else if (arg == "--cache-automata" && i + 1 < argc) {
+            ruta_cache = argv[++i];
+        } else if (arg == "--glr") {
+            glr = true;
+        } else if (arg == "--arbol") {
+            arbol.activo = true;
+        } else if (arg == "--arbol-solo" && i + 1 < argc) {
+            arbol.activo = true;
+            solo_arbol = argv[++i];
+        } else if (arg == "--flujo") {
+            flujo = true;
+        } else if (arg == "--perezosa") {
+            perezosa = true;
+        } else if (arg == "--volcar-estados" && i + 1 < argc) {
+            volcado_salida = argv[++i];
+        } else if (arg == "--precargar-estados" && i + 1 < argc) {
+            volcado_entrada = argv[++i];
+        } else if (arg == "--tabla" && i + 1 < argc) {
+            tabla_entrada = argv[++i];
+        } else if (arg == "--modo" && i + 1 < argc) {
+            modo = argv[++i];
+            if (modo != "lr1" && modo != "lalr" && modo != "minimo") {
+                cerr << "Error: modo desconocido '" << modo << "' (lr1, lalr o minimo)." << endl;
+                return 1;
+            }
+        } else if (arg == "--hilos" && i + 1 < argc) {
+            string valor = argv[++i];
+            if (valor.empty() || valor.size() > 6 || valor.find_first_not_of("0123456789") != string::npos) {
+                cerr << "Error: --hilos espera un numero de hilos, no '" << valor << "'." << endl;
+                return 1;
+            }
+            hilos = max(1, stoi(valor));
+        } else if (arg == "--stats") {
+            estadisticas.activas = true;
+            if (i + 1 < argc && (string(argv[i + 1]) == "json" || string(argv[i + 1]) == "texto")) {
+                stats_json = string(argv[++i]) == "json";
+            }
+        } else if (arg == "--comparar-modos") {
+            comparar = true;
+        } else if (arg == "--comprimida") {
+            usar_comprimida = true;
+        } else if (arg == "--tamano-tablas") {
+            reportar_tamano = true;
+        } else if (arg == "--bench-parse") {
+            bench_tokens = cantidad_opcional(argc, argv, i, 1000000);
+        }
+    }
+
+    if (!rutas_lexear.empty()) {
+        return lexear_lote(rutas_lexear, hilos);
+    }
+
+    if (!prefijo_scanner.empty() || bench_scanner_sentencias) {
+        TablasScanner tablas;
+        string error;
+        if (!cargar_scanner(ruta_tokens, tablas, error)) {
+            cerr << "Error: " << error << "." << endl;
+            return 1;
+        }
+        if (!prefijo_scanner.empty() && !generar_scanner_cpp(prefijo_scanner, tablas)) {
+            return 1;
+        }
+        if (bench_scanner_sentencias) {
+            return bench_scanner(tablas, bench_scanner_sentencias);
+        }
+        return 0;
+    }
+
+    if (!tabla_entrada.empty()) {
+        ArchivoTabla archivo;
+        string error;
+        if (!archivo.abrir(tabla_entrada, error)) {
+            cerr << "Error: " << error << "." << endl;
+            return 1;
+        }
+        if (gramatica_explicita && archivo.cabecera().hash_gramatica != hash_gramatica(archivo_gramatica)) {
+            cerr << "Error: la tabla '" << tabla_entrada << "' no corresponde a " << archivo_gramatica << "." << endl;
+            return 1;
+        }
+        if (!ruta_lote.empty()) {
+            return parsear_lote(ruta_lote, archivo.simbolos, archivo.tabla, hilos);
+        }
+        if (!solo_arbol.empty() && !elegir_simbolos_arbol(solo_arbol, archivo.simbolos, arbol)) {
+            return 1;
+        }
+        if (!ruta_programa.empty()) {
+            return parse_programa(ruta_programa, archivo.simbolos, archivo.tabla, arbol) ? 0 : 1;
+        }
+        if (!rutas_incrementales.empty()) {
+            return parse_incremental(rutas_incrementales, archivo.simbolos, archivo.tabla);
+        }
+        analizar_stdin(archivo.simbolos, archivo.tabla, flujo, arbol);
+        return 0;
+    }
+
+    Reglas reglas;
+    bool leida;
+    estadisticas.medir_fase("carga de gramatica", [&] { leida = leer_reglas(archivo_gramatica, reglas); });
+    if (!leida) {
+        return 1;
+    }
+    if (reglas.empty()) {
+        cerr << "Error: la gramatica no tiene producciones." << endl;
+        return 1;
+    }
+    Gramatica g;
+    estadisticas.medir_fase("construccion de simbolos", [&] { g = construir_gramatica(reglas); });
+    if (!solo_arbol.empty() && !elegir_simbolos_arbol(solo_arbol, g.simbolos, arbol)) {
+        return 1;
+    }
+    if (comparar) {
+        return comparar_modos(g, hilos);
+    }
+    if (!ruta_cache.empty() && (perezosa || modo == "lalr")) {
+        cerr << "Error: --cache-automata guarda el automata LR(1) canonico; no se usa con --perezosa ni con el modo lalr." << endl;
+        return 1;
+    }
+    AnalisisGramatica analisis;
+    Automata automata;
+    if (ruta_cache.empty()) {
+        estadisticas.medir_fase("FIRST", [&] { analisis = analizar_gramatica(g.producciones, g.simbolos); });
+    } else if (!regenerar_automata(ruta_cache, modo, g, hilos, analisis, automata)) {
+        return 1;
+    }
+    if (perezosa) {
+        if (modo != "lr1") {
+            cerr << "Error: --perezosa solo construye el automata LR(1) canonico." << endl;
+            return 1;
+        }
+        TablaPerezosa tabla(g, analisis);
+        string error;
+        if (!volcado_entrada.empty() && !tabla.precargar(volcado_entrada, hash_gramatica(archivo_gramatica), error)) {
+            cerr << "Error: " << error << "." << endl;
+            return 1;
+        }
+        estadisticas.medir_fase("analisis perezoso", [&] { analizar_stdin(g.simbolos, tabla, flujo, arbol); });
+        cout << "Estados construidos: " << tabla.num_estados() << endl;
+        if (estadisticas.activas) {
+            imprimir_estadisticas(stats_json, tabla.num_estados());
+        }
+        if (!volcado_salida.empty() && !tabla.volcar(volcado_salida, hash_gramatica(archivo_gramatica))) {
+            return 1;
+        }
+        return 0;
+    }
+    if (ruta_cache.empty()) {
+        estadisticas.medir_fase("automata", [&] { automata = construir_segun_modo(modo, g, analisis, hilos); });
+    }
+    if (glr) {
+        if (estadisticas.activas) {
+            imprimir_estadisticas(stats_json, automata.estados.size());
+        }
+        return parse_glr(g, automata, arbol.activo);
+    }
+    TablaLR tabla;
+    TablaComprimida comprimida;
+    estadisticas.medir_fase("emision de tablas", [&] {
+        tabla = construir_tabla(automata, g);
+        comprimida = comprimir_tabla(tabla);
+    });
+    if (estadisticas.activas) {
+        imprimir_estadisticas(stats_json, automata.estados.size());
+    }
+    if (reportar_tamano) {
+        size_t filas = comprimida.peine_accion.base.size();
+        cout << "Estados: " << tabla.num_estados << ", filas ACTION distintas: " << filas << endl;
+        cout << "Tabla densa:      " << bytes_tabla_densa(tabla) << " bytes" << endl;
+        cout << "Tabla comprimida: " << comprimida.bytes() << " bytes ("
+             << 100.0 * comprimida.bytes() / bytes_tabla_densa(tabla) << "%)" << endl;
+        return 0;
+    }
+    if (!ruta_lote.empty()) {
+        if (usar_comprimida) {
+            return parsear_lote(ruta_lote, g.simbolos, comprimida.vista(), hilos);
+        }
+        return parsear_lote(ruta_lote, g.simbolos, tabla, hilos);
+    }
+    if (bench_sentencias > 0) {
+        return bench_programa(g, tabla, bench_sentencias);
+    }
+    if (!ruta_programa.empty()) {
+        if (usar_comprimida) {
+            return parse_programa(ruta_programa, g.simbolos, comprimida.vista(), arbol) ? 0 : 1;
+        }
+        return parse_programa(ruta_programa, g.simbolos, tabla, arbol) ? 0 : 1;
+    }
+    if (bench_incremental_sentencias > 0) {
+        return bench_incremental(g, tabla, bench_incremental_sentencias);
+    }
+    if (!rutas_incrementales.empty()) {
+        if (usar_comprimida) {
+            return parse_incremental(rutas_incrementales, g.simbolos, comprimida.vista());
+        }
+        return parse_incremental(rutas_incrementales, g.simbolos, tabla);
+    }
+    if (bench_tokens > 0) {
+        return bench_parse(g, tabla, comprimida.vista(), bench_tokens);
+    }
+    if (!tabla_salida.empty()) {
+        if (!escribir_tabla_binaria(tabla_salida, g, comprimida, hash_gramatica(archivo_gramatica))) {
+            return 1;
+        }
+        cout << "Tabla escrita en " << tabla_salida << " (" << tabla.num_estados << " estados)." << endl;
+        return 0;
+    }
+    if (!prefijo_cpp.empty()) {
+        if (!generar_cpp(prefijo_cpp, g, tabla, comprimida, directo)) {
+            return 1;
+        }
+        cout << "Parser generado en " << prefijo_cpp << ".h y " << prefijo_cpp << ".cpp (" << tabla.num_estados << " estados)." << endl;
+        return 0;
+    }
+
+    imprimir_tabla(g, tabla, modo);
+
+    if (usar_comprimida) {
+        analizar_stdin(g.simbolos, comprimida.vista(), flujo, arbol);
+    } else {
+        analizar_stdin(g.simbolos, tabla, flujo, arbol);
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,34 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "parser_generado.h"
+
+using namespace std;
+
+// Programa de produccion: usa las tablas generadas por parser --generar-cpp, sin leer
+// la gramatica ni construir el automata.
+int main() {
+    cout << "Ingrese la cadena: ";
+    string input_line;
+    getline(cin, input_line);
+    stringstream ss(input_line);
+    vector<int> input;
+    string tok;
+    while (ss >> tok) {
+        int id = parser_generado::buscar_terminal(tok.c_str());
+        if (id < 0) {
+            cout << "Cadena rechazada (símbolo desconocido '" << tok << "')." << endl;
+            return 0;
+        }
+        input.push_back(id);
+    }
+
+    if (parser_generado::analizar(input.data(), input.size())) {
+        cout << "Cadena aceptada." << endl;
+    } else {
+        cout << "Cadena rechazada." << endl;
+    }
+    return 0;
+}
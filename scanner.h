@@ -0,0 +1,636 @@
+#pragma once
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scanner_simd.h"
+
+using namespace std;
+
+enum class TokenType {
+    IDENTIFIER,
+    INT,
+    STRING,
+    FLOAT,
+    BOOLV,
+    BOOLF,
+    CREATE,
+    PAPER, 
+    IF, 
+    ELSE, 
+    THEN, 
+    FROM, 
+    TO, 
+    WHILE, 
+    IS,
+    RETURN, 
+    IN, 
+    CALCULATE,
+    SQRT, 
+    QBIC,
+
+    ASSIGN,        
+    PLUS,          
+    MINUS,         
+    MULTI,         
+    DIVISION,      
+    IN_OP,         
+    OUT_OP,        
+    IN_LV,         
+    OUT_LV,        
+    SIMILAR,       
+    LESS_THAN,     
+    GREATER_THAN,
+    LESS_EQUAL,
+    GREATER_EQUAL,
+    NOT_EQUAL,  
+    POSITION,      
+    NOM,           
+    INCREMENT,     
+    DECREMENT,     
+    POWER,         
+    QUOTE,
+    END_OF_FILE,         
+    UNKNOWN
+};
+
+// Palabras reservadas con un hash perfecto calculado en compilacion: la longitud y el
+// primer y ultimo caracter bastan para separarlas, y static_assert lo comprueba si se
+// agrega una palabra.
+struct PalabraClave {
+    string_view texto;
+    TokenType type;
+};
+
+inline constexpr PalabraClave PALABRAS_CLAVE[] = {
+    {"int", TokenType::INT},
+    {"str", TokenType::STRING},
+    {"float", TokenType::FLOAT},
+    {"boolv", TokenType::BOOLV},
+    {"boolf", TokenType::BOOLF},
+    {"create", TokenType::CREATE},
+    {"paper", TokenType::PAPER},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"then", TokenType::THEN},
+    {"from", TokenType::FROM},
+    {"to", TokenType::TO},
+    {"while", TokenType::WHILE},
+    {"is", TokenType::IS},
+    {"return", TokenType::RETURN},
+    {"in", TokenType::IN},
+    {"calculate", TokenType::CALCULATE},
+    {"sqrt", TokenType::SQRT},
+    {"qbic", TokenType::QBIC},
+};
+
+constexpr size_t NUM_CUBETAS_PALABRAS = 32;
+
+constexpr size_t hash_palabra(string_view texto) {
+    return ((unsigned char)texto.front() * 9 + (unsigned char)texto.back() * 5 + texto.size()) % NUM_CUBETAS_PALABRAS;
+}
+
+constexpr bool hash_palabras_perfecto() {
+    for (size_t i = 0; i < size(PALABRAS_CLAVE); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (hash_palabra(PALABRAS_CLAVE[i].texto) == hash_palabra(PALABRAS_CLAVE[j].texto)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(hash_palabras_perfecto(), "dos palabras reservadas caen en la misma cubeta; cambiar hash_palabra");
+
+// Cubeta -> indice en PALABRAS_CLAVE, o -1.
+constexpr array<int8_t, NUM_CUBETAS_PALABRAS> construir_cubetas_palabras() {
+    array<int8_t, NUM_CUBETAS_PALABRAS> cubetas{};
+    for (auto& c : cubetas) {
+        c = -1;
+    }
+    for (size_t i = 0; i < size(PALABRAS_CLAVE); ++i) {
+        cubetas[hash_palabra(PALABRAS_CLAVE[i].texto)] = i;
+    }
+    return cubetas;
+}
+
+inline constexpr array<int8_t, NUM_CUBETAS_PALABRAS> CUBETAS_PALABRAS = construir_cubetas_palabras();
+
+struct Token {
+    TokenType type;
+    string valor;
+    int linea;
+    int columna;
+};
+
+// Palabra reservada con ese texto, o IDENTIFIER si no lo es: una busqueda en
+// CUBETAS_PALABRAS y una sola comparacion.
+inline TokenType palabra_clave(string_view valor) {
+    if (valor.empty()) {
+        return TokenType::IDENTIFIER;
+    }
+    int i = CUBETAS_PALABRAS[hash_palabra(valor)];
+    if (i >= 0 && PALABRAS_CLAVE[i].texto == valor) {
+        return PALABRAS_CLAVE[i].type;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+// Modo por flujo: el estado es global, asi que se analiza un archivo a la vez. Scanner,
+// mas abajo, es el modo mapeado y reentrante.
+inline ifstream archivo;
+inline int linea_actual = 1;
+inline int columna_actual = 0;
+inline char letra_actual = ' ';
+
+// Abre ruta como fuente del scanner y reinicia la posicion.
+inline bool abrir_fuente(const string& ruta) {
+    archivo.close();
+    archivo.clear();
+    archivo.open(ruta);
+    linea_actual = 1;
+    columna_actual = 0;
+    letra_actual = ' ';
+    return archivo.is_open();
+}
+
+inline char get_char() {
+    if (archivo.get(letra_actual)) {
+        columna_actual++;
+        if (letra_actual == '\n') {
+            linea_actual++;
+            columna_actual = 0;
+        }
+        return letra_actual;
+    } else {
+        letra_actual = EOF;
+        return EOF;
+    }
+}
+
+inline char peek_char() {
+    return archivo.peek();
+}
+
+inline void blanco() {
+    while (isspace(letra_actual) || (letra_actual == '/')) {
+        if (isspace(letra_actual)) {
+            get_char();
+        } else if (letra_actual == '/') {
+            char next_char = peek_char();
+            if (next_char == '/') {
+                get_char();
+                while (letra_actual != '\n' && letra_actual != EOF) {
+                    get_char();
+                }
+            } else if (next_char == '*') {
+                get_char();
+                while (true) {
+                    get_char();
+                    if (letra_actual == '*' && peek_char() == '/') {
+                        get_char();
+                        get_char();
+                        break;
+                    } else if (letra_actual == EOF) {
+                        cerr << "Error: Comentario no cerrado" << endl;
+                        return; 
+                    }
+                }
+            } else {
+                break; 
+            }
+        }
+    }
+}
+
+// Las posiciones son las del primer caracter del token; la del fin de archivo es la
+// columna siguiente al ultimo caracter.
+inline Token get_Token() {
+    blanco();
+    int ini_linea = linea_actual;
+    int ini_col = columna_actual;
+    if(letra_actual == EOF) {
+        return {TokenType::END_OF_FILE, "", ini_linea, ini_col + 1};
+    }
+
+    if(isalpha(letra_actual)) {
+        string valor;
+        while(isalnum(letra_actual)) {
+            valor += letra_actual;
+            get_char();
+        }
+        return {palabra_clave(valor), valor, ini_linea, ini_col};
+    }
+
+    if(isdigit(letra_actual)) {
+        string valor;
+        bool es_float = false;
+
+        while(isdigit(letra_actual) || letra_actual == '.') {
+            if(letra_actual == '.') {
+                if(es_float) {
+                    cerr << "Error: Numero flotante con más de un punto decimal" << linea_actual << "," << ini_col << endl;
+                    return {TokenType::UNKNOWN, "", ini_linea, ini_col};
+                }
+                es_float = true;
+            }
+            valor += letra_actual;
+            get_char();
+        }
+
+        if(es_float) {
+            return {TokenType::FLOAT, valor, ini_linea, ini_col};
+        } else {
+            return {TokenType::INT, valor, ini_linea, ini_col};
+        }
+    }
+
+    if (letra_actual == '=') {
+        get_char(); 
+        if (letra_actual == '=') {
+            get_char(); 
+            return {TokenType::SIMILAR, "==", ini_linea, ini_col};
+        } else {
+            return {TokenType::ASSIGN, "=", ini_linea, ini_col};
+        }
+    } else if (letra_actual == '>') {
+        get_char();
+        if (letra_actual == '=') {
+            get_char();
+            return {TokenType::GREATER_EQUAL, ">=", ini_linea, ini_col};
+        } else {
+            return {TokenType::GREATER_THAN, ">", ini_linea, ini_col};
+        }
+    } else if (letra_actual == '<') {
+        get_char();
+        if (letra_actual == '=') {
+            get_char();
+            return {TokenType::LESS_EQUAL, "<=", ini_linea, ini_col};
+        } else {
+            return {TokenType::LESS_THAN, "<", ini_linea, ini_col};
+        }
+    } else if (letra_actual == '!') {
+        get_char();
+        if (letra_actual == '=') {
+            get_char();
+            return {TokenType::NOT_EQUAL, "!=", ini_linea, ini_col};
+        } else {
+            cerr << "Error léxico: Carácter no válido '!' en línea " << ini_linea << ", columna " << ini_col << endl;
+            return {TokenType::UNKNOWN, "!", ini_linea, ini_col};
+        }
+    } else if (letra_actual == '-') {
+        get_char();
+        if (letra_actual == '>') {
+            get_char();
+            return {TokenType::NOM, "->", ini_linea, ini_col};
+        } else if (letra_actual == '-') {
+            get_char();
+            return {TokenType::DECREMENT, "--", ini_linea, ini_col};
+        } else {
+            return {TokenType::MINUS, "-", ini_linea, ini_col};
+        }
+    } else if (letra_actual == '+') {
+        get_char();
+        if (letra_actual == '+') {
+            get_char();
+            return {TokenType::INCREMENT, "++", ini_linea, ini_col};
+        } else {
+            return {TokenType::PLUS, "+", ini_linea, ini_col};
+        }
+    } else {
+        switch (letra_actual) {
+            case '*':
+                get_char();
+                return {TokenType::MULTI, "*", ini_linea, ini_col};
+            case '/':
+                get_char();
+                return {TokenType::DIVISION, "/", ini_linea, ini_col};
+            case '{':
+                get_char();
+                return {TokenType::IN_OP, "{", ini_linea, ini_col};
+            case '}':
+                get_char();
+                return {TokenType::OUT_OP, "}", ini_linea, ini_col};
+            case '[':
+                get_char();
+                return {TokenType::IN_LV, "[", ini_linea, ini_col};
+            case ']':
+                get_char();
+                return {TokenType::OUT_LV, "]", ini_linea, ini_col};
+            case ',':
+                get_char();
+                return {TokenType::POSITION, ",", ini_linea, ini_col};
+            case '^':
+                get_char();
+                return {TokenType::POWER, "^", ini_linea, ini_col};
+            case '"':
+                get_char();
+                return {TokenType::QUOTE, "\"", ini_linea, ini_col};
+            default:
+                std::cerr << "Error: Caracter invalido '" << letra_actual << "' en línea " << linea_actual << ", columna " << columna_actual << std::endl;
+                get_char();
+                return {TokenType::UNKNOWN, "", ini_linea, ini_col};
+        }
+    }
+}
+
+// Modo mapeado: la fuente entera queda en memoria y se analiza recorriendo punteros, sin
+// una llamada al flujo por caracter ni un string por token. Da los mismos tokens que
+// get_Token().
+struct TokenVista {
+    TokenType type;
+    string_view valor;  // apunta a la fuente mapeada; vale hasta que se abra otra
+    int linea;
+    int columna;
+};
+
+// Contenido de un archivo: mapeado con mmap, o leido en bloques grandes si no se puede
+// mapear (tuberias, archivos vacios o especiales).
+class BufferFuente {
+public:
+    BufferFuente() = default;
+    BufferFuente(const BufferFuente&) = delete;
+    BufferFuente& operator=(const BufferFuente&) = delete;
+
+    ~BufferFuente() {
+        cerrar();
+    }
+
+    bool abrir(const string& ruta) {
+        cerrar();
+        int fd = open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                close(fd);
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                mapa = p;
+                datos = static_cast<const char*>(p);
+                tamano = st.st_size;
+                return true;
+            }
+        }
+        const size_t BLOQUE = 1 << 20;
+        size_t leidos = 0;
+        while (true) {
+            copia.resize(leidos + BLOQUE);
+            ssize_t n = read(fd, copia.data() + leidos, BLOQUE);
+            if (n <= 0) {
+                close(fd);
+                copia.resize(leidos);
+                datos = copia.data();
+                tamano = leidos;
+                return n == 0;
+            }
+            leidos += n;
+        }
+    }
+
+    void cerrar() {
+        if (mapa) {
+            munmap(mapa, tamano);
+            mapa = nullptr;
+        }
+        copia.clear();
+        datos = nullptr;
+        tamano = 0;
+    }
+
+    const char* inicio() const {
+        return datos;
+    }
+
+    const char* fin() const {
+        return datos + tamano;
+    }
+
+private:
+    void* mapa = nullptr;
+    vector<char> copia;
+    const char* datos = nullptr;
+    size_t tamano = 0;
+};
+
+// Scanner reentrante del modo mapeado: cada instancia tiene su propia fuente y su
+// posicion, asi que varios hilos pueden analizar archivos distintos a la vez. Los errores
+// lexicos se escriben en *errores. Las corridas de blancos, identificadores, digitos y
+// comentarios se recorren con *kernels.
+class Scanner {
+public:
+    ostream* errores = &cerr;
+    const KernelsLexicos* kernels = &kernels_lexicos();
+
+    // Abre ruta como fuente y reinicia la posicion.
+    bool abrir(const string& ruta) {
+        bool ok = buffer.abrir(ruta);
+        pos_fuente = inicio_linea = buffer.inicio();
+        fin_fuente = buffer.fin();
+        linea_fuente = 1;
+        return ok;
+    }
+
+    void cerrar() {
+        buffer.cerrar();
+        pos_fuente = fin_fuente = inicio_linea = nullptr;
+    }
+
+    size_t bytes() const {
+        return buffer.fin() - buffer.inicio();
+    }
+
+    TokenVista siguiente() {
+        blanco();
+        const char* inicio = pos_fuente;
+        const char* p = inicio;
+        int linea = linea_fuente;
+        int columna = int(inicio - inicio_linea) + 1;
+        if (p == fin_fuente) {
+            return {TokenType::END_OF_FILE, {}, linea, columna};
+        }
+
+        if (es_letra_ascii(*p)) {
+            p = corrida(p + 1, es_alnum_ascii, kernels->fin_alnum);
+            pos_fuente = p;
+            string_view valor(inicio, p - inicio);
+            return {palabra_clave(valor), valor, linea, columna};
+        }
+
+        if (es_digito_ascii(*p)) {
+            p = corrida(p + 1, es_digito_ascii, kernels->fin_digitos);
+            bool es_float = p < fin_fuente && *p == '.';
+            if (es_float) {
+                p = corrida(p + 1, es_digito_ascii, kernels->fin_digitos);
+                if (p < fin_fuente && *p == '.') {
+                    pos_fuente = p;
+                    *errores << "Error: Numero flotante con más de un punto decimal" << linea << "," << columna << endl;
+                    return {TokenType::UNKNOWN, {}, linea, columna};
+                }
+            }
+            pos_fuente = p;
+            return {es_float ? TokenType::FLOAT : TokenType::INT, string_view(inicio, p - inicio), linea, columna};
+        }
+
+        // Operadores: los de dos caracteres se eligen mirando el siguiente.
+        char c = *p;
+        char siguiente = p + 1 < fin_fuente ? p[1] : '\0';
+        int largo = 1;
+        auto par = [&](char segundo, TokenType doble, TokenType simple) {
+            if (siguiente != segundo) {
+                return simple;
+            }
+            largo = 2;
+            return doble;
+        };
+        TokenType type;
+        switch (c) {
+            case '=': type = par('=', TokenType::SIMILAR, TokenType::ASSIGN); break;
+            case '>': type = par('=', TokenType::GREATER_EQUAL, TokenType::GREATER_THAN); break;
+            case '<': type = par('=', TokenType::LESS_EQUAL, TokenType::LESS_THAN); break;
+            case '!': type = par('=', TokenType::NOT_EQUAL, TokenType::UNKNOWN); break;
+            case '-': type = siguiente == '-' ? par('-', TokenType::DECREMENT, TokenType::MINUS) : par('>', TokenType::NOM, TokenType::MINUS); break;
+            case '+': type = par('+', TokenType::INCREMENT, TokenType::PLUS); break;
+            case '*': type = TokenType::MULTI; break;
+            case '/': type = TokenType::DIVISION; break;
+            case '{': type = TokenType::IN_OP; break;
+            case '}': type = TokenType::OUT_OP; break;
+            case '[': type = TokenType::IN_LV; break;
+            case ']': type = TokenType::OUT_LV; break;
+            case ',': type = TokenType::POSITION; break;
+            case '^': type = TokenType::POWER; break;
+            case '"': type = TokenType::QUOTE; break;
+            default:
+                pos_fuente = p + 1;
+                *errores << "Error: Caracter invalido '" << c << "' en línea " << linea << ", columna " << columna << endl;
+                return {TokenType::UNKNOWN, {}, linea, columna};
+        }
+        pos_fuente = p + largo;
+        if (type == TokenType::UNKNOWN) {
+            *errores << "Error léxico: Carácter no válido '!' en línea " << linea << ", columna " << columna << endl;
+        }
+        return {type, string_view(inicio, largo), linea, columna};
+    }
+
+private:
+    BufferFuente buffer;
+    const char* pos_fuente = nullptr;
+    const char* fin_fuente = nullptr;
+    const char* inicio_linea = nullptr;
+    int linea_fuente = 1;
+
+    void blanco() {
+        const char* p = pos_fuente;
+        while (p < fin_fuente) {
+            if (*p == ' ' && (p + 1 == fin_fuente || !es_blanco_ascii(p[1]))) {
+                // Un solo espacio entre tokens, el caso mas comun.
+                ++p;
+            } else if (es_blanco_ascii(*p)) {
+                const char* q = kernels->fin_blancos(p, fin_fuente);
+                contar_lineas(p, q);
+                p = q;
+            } else if (*p == '/' && p + 1 < fin_fuente && p[1] == '/') {
+                p = kernels->buscar_salto(p + 2, fin_fuente);
+            } else if (*p == '/' && p + 1 < fin_fuente && p[1] == '*') {
+                const char* q = kernels->buscar_cierre(p + 2, fin_fuente);
+                contar_lineas(p + 2, q);
+                if (q == fin_fuente) {
+                    *errores << "Error: Comentario no cerrado" << endl;
+                    p = q;
+                } else {
+                    p = q + 2;
+                }
+            } else {
+                break;
+            }
+        }
+        pos_fuente = p;
+    }
+
+    // Los primeros bytes de una corrida se miran aca mismo: la mayoria de los
+    // identificadores y numeros son cortos y no compensan la llamada al nucleo.
+    const char* corrida(const char* p, bool (*en_clase)(unsigned char), const char* (*nucleo)(const char*, const char*)) {
+        const char* limite = fin_fuente - p > 8 ? p + 8 : fin_fuente;
+        while (p < limite && en_clase(*p)) ++p;
+        return p == limite ? nucleo(p, fin_fuente) : p;
+    }
+
+    void contar_lineas(const char* desde, const char* hasta) {
+        const char* ultimo = nullptr;
+        size_t n = kernels->contar_saltos(desde, hasta, ultimo);
+        if (n) {
+            linea_fuente += n;
+            inicio_linea = ultimo + 1;
+        }
+    }
+};
+
+// Scanner compartido de mapear_fuente() y get_Token_mapeado(), para un archivo a la vez.
+inline Scanner scanner_mapeado;
+
+inline bool mapear_fuente(const string& ruta) {
+    return scanner_mapeado.abrir(ruta);
+}
+
+inline TokenVista get_Token_mapeado() {
+    return scanner_mapeado.siguiente();
+}
+
+inline string Token_type(TokenType type) {
+    switch(type) {
+        case TokenType::IDENTIFIER: return "IDENTIFIER";
+        case TokenType::INT: return "INT";
+        case TokenType::STRING: return "STRING";
+        case TokenType::FLOAT: return "FLOAT";
+        case TokenType::BOOLV: return "BOOLV";
+        case TokenType::BOOLF: return "BOOLF";
+        case TokenType::CREATE: return "CREATE";
+        case TokenType::PAPER: return "PAPER";
+        case TokenType::IF: return "IF";
+        case TokenType::ELSE: return "ELSE";
+        case TokenType::THEN: return "THEN";
+        case TokenType::FROM: return "FROM";
+        case TokenType::TO: return "TO";
+        case TokenType::WHILE: return "WHILE";
+        case TokenType::IS: return "IS";
+        case TokenType::RETURN: return "RETURN";
+        case TokenType::IN: return "IN";
+        case TokenType::CALCULATE: return "CALCULATE";
+        case TokenType::SQRT: return "SQRT";
+        case TokenType::QBIC: return "QBIC";
+        case TokenType::ASSIGN: return "ASSIGN";
+        case TokenType::PLUS: return "PLUS";
+        case TokenType::MINUS: return "MINUS";
+        case TokenType::MULTI: return "MULTI";
+        case TokenType::DIVISION: return "DIVISION";
+        case TokenType::IN_OP: return "IN_OP";
+        case TokenType::OUT_OP: return "OUT_OP";
+        case TokenType::IN_LV: return "IN_LV";
+        case TokenType::OUT_LV: return "OUT_LV";
+        case TokenType::SIMILAR: return "SIMILAR";
+        case TokenType::LESS_THAN: return "LESS_THAN";
+        case TokenType::GREATER_THAN: return "GREATER_THAN";
+        case TokenType::LESS_EQUAL: return "LESS_EQUAL";
+        case TokenType::GREATER_EQUAL: return "GREATER_EQUAL";
+        case TokenType::NOT_EQUAL: return "NOT_EQUAL";
+        case TokenType::POSITION: return "POSITION";
+        case TokenType::NOM: return "NOM";
+        case TokenType::INCREMENT: return "INCREMENT";
+        case TokenType::DECREMENT: return "DECREMENT";
+        case TokenType::POWER: return "POWER";
+        case TokenType::QUOTE: return "QUOTE";
+        case TokenType::UNKNOWN: return "UNKNOWN";
+        default: return "UNKNOWN";
+    }
+}
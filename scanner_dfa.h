@@ -0,0 +1,589 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <sstream>
+
+#include "scanner.h"
+
+// Generador de scanners: una especificacion con una expresion regular por token se compila
+// a un AFD minimo. Los bytes se agrupan en clases de equivalencia (bytes con la misma
+// columna en la tabla de transiciones), asi que ScannerDFA avanza cada caracter con una
+// busqueda en CLASE y otra en la tabla, sin llamadas a ctype.
+//
+// Especificacion: una regla "NOMBRE expresion" por linea; # empieza un comentario.
+// NOMBRE es un TokenType tal como lo escribe Token_type(), IGNORAR para blancos y
+// comentarios, o ERROR para entradas invalidas que conviene reportar enteras. Gana la
+// coincidencia mas larga y, a igual largo, la regla que aparece primero.
+//
+// Expresiones: bytes literales, \ para escapar (\n \t \r \f \v), . (cualquier byte salvo
+// \n), clases [a-z] y [^...], grupos ( ), alternativas |, y los operadores * + ?.
+
+enum class AccionRegla {
+    TOKEN,
+    IGNORAR,
+    ERROR
+};
+
+struct ReglaToken {
+    string nombre;
+    AccionRegla accion;
+    TokenType type;
+    bool cruza_lineas;  // su lexema puede contener '\n'
+};
+
+// Tablas del AFD minimo. El estado 0 es el muerto y el 1 el inicial; los estados desde
+// primer_aceptador aceptan la regla regla[estado].
+struct TablasScanner {
+    vector<ReglaToken> reglas;
+    int num_clases = 0;
+    int num_estados = 0;
+    int primer_aceptador = 0;
+    uint8_t clase[256] = {};
+    vector<uint16_t> transicion;  // estado * num_clases + clase -> estado
+    vector<int16_t> regla;        // por estado, -1 si no acepta
+};
+
+// Automata de Thompson: cada estado tiene transiciones epsilon o una transicion por un
+// conjunto de bytes.
+struct EstadoAFN {
+    bitset<256> bytes;
+    int siguiente = -1;
+    vector<int> epsilon;
+    int regla = -1;
+};
+
+class CompiladorRegex {
+public:
+    CompiladorRegex(const string& texto, vector<EstadoAFN>& afn) : texto(texto), afn(afn) {}
+
+    // Agrega al AFN el fragmento de la expresion; devuelve su estado inicial y el final.
+    bool compilar(int& inicio, int& fin, string& error) {
+        Fragmento f;
+        if (!alternativas(f)) {
+            error = this->error;
+            return false;
+        }
+        if (pos < texto.size()) {
+            error = "')' sin abrir en la posicion " + to_string(pos + 1);
+            return false;
+        }
+        inicio = f.inicio;
+        fin = f.fin;
+        return true;
+    }
+
+private:
+    struct Fragmento {
+        int inicio, fin;
+    };
+
+    const string& texto;
+    vector<EstadoAFN>& afn;
+    size_t pos = 0;
+    string error;
+
+    int nuevo() {
+        afn.emplace_back();
+        return afn.size() - 1;
+    }
+
+    Fragmento vacio() {
+        int s = nuevo(), e = nuevo();
+        afn[s].epsilon.push_back(e);
+        return {s, e};
+    }
+
+    bool fallar(const string& mensaje) {
+        error = mensaje + " en la posicion " + to_string(pos + 1);
+        return false;
+    }
+
+    bool alternativas(Fragmento& f) {
+        if (!concatenacion(f)) {
+            return false;
+        }
+        while (pos < texto.size() && texto[pos] == '|') {
+            ++pos;
+            Fragmento otra;
+            if (!concatenacion(otra)) {
+                return false;
+            }
+            int s = nuevo(), e = nuevo();
+            afn[s].epsilon = {f.inicio, otra.inicio};
+            afn[f.fin].epsilon.push_back(e);
+            afn[otra.fin].epsilon.push_back(e);
+            f = {s, e};
+        }
+        return true;
+    }
+
+    bool concatenacion(Fragmento& f) {
+        f = vacio();
+        while (pos < texto.size() && texto[pos] != '|' && texto[pos] != ')') {
+            Fragmento siguiente;
+            if (!repeticion(siguiente)) {
+                return false;
+            }
+            afn[f.fin].epsilon.push_back(siguiente.inicio);
+            f.fin = siguiente.fin;
+        }
+        return true;
+    }
+
+    bool repeticion(Fragmento& f) {
+        if (!atomo(f)) {
+            return false;
+        }
+        while (pos < texto.size() && (texto[pos] == '*' || texto[pos] == '+' || texto[pos] == '?')) {
+            char op = texto[pos++];
+            int s = nuevo(), e = nuevo();
+            afn[s].epsilon.push_back(f.inicio);
+            if (op != '+') {
+                afn[s].epsilon.push_back(e);
+            }
+            if (op != '?') {
+                afn[f.fin].epsilon.push_back(f.inicio);
+            }
+            afn[f.fin].epsilon.push_back(e);
+            f = {s, e};
+        }
+        return true;
+    }
+
+    bool atomo(Fragmento& f) {
+        if (pos == texto.size()) {
+            return fallar("falta una expresion");
+        }
+        char c = texto[pos];
+        bitset<256> bytes;
+        if (c == '(') {
+            ++pos;
+            if (!alternativas(f)) {
+                return false;
+            }
+            if (pos == texto.size() || texto[pos] != ')') {
+                return fallar("falta ')'");
+            }
+            ++pos;
+            return true;
+        } else if (c == '*' || c == '+' || c == '?') {
+            return fallar(string("'") + c + "' sin operando");
+        } else if (c == '[') {
+            ++pos;
+            if (!clase(bytes)) {
+                return false;
+            }
+        } else if (c == '.') {
+            ++pos;
+            bytes.set();
+            bytes.reset('\n');
+        } else {
+            unsigned char b;
+            if (!byte(b)) {
+                return false;
+            }
+            bytes.set(b);
+        }
+        int s = nuevo(), e = nuevo();
+        afn[s].bytes = bytes;
+        afn[s].siguiente = e;
+        f = {s, e};
+        return true;
+    }
+
+    bool byte(unsigned char& b) {
+        if (texto[pos] != '\\') {
+            b = texto[pos++];
+            return true;
+        }
+        if (++pos == texto.size()) {
+            return fallar("'\\' al final");
+        }
+        switch (texto[pos++]) {
+            case 'n': b = '\n'; break;
+            case 't': b = '\t'; break;
+            case 'r': b = '\r'; break;
+            case 'f': b = '\f'; break;
+            case 'v': b = '\v'; break;
+            default: b = texto[pos - 1]; break;
+        }
+        return true;
+    }
+
+    bool clase(bitset<256>& bytes) {
+        bool negada = pos < texto.size() && texto[pos] == '^';
+        if (negada) {
+            ++pos;
+        }
+        bool primero = true;
+        while (pos < texto.size() && (texto[pos] != ']' || primero)) {
+            primero = false;
+            unsigned char desde = 0, hasta;
+            if (!byte(desde)) {
+                return false;
+            }
+            hasta = desde;
+            if (pos + 1 < texto.size() && texto[pos] == '-' && texto[pos + 1] != ']') {
+                ++pos;
+                if (!byte(hasta)) {
+                    return false;
+                }
+                if (hasta < desde) {
+                    return fallar("rango invertido");
+                }
+            }
+            for (int b = desde; b <= hasta; ++b) {
+                bytes.set(b);
+            }
+        }
+        if (pos == texto.size()) {
+            return fallar("falta ']'");
+        }
+        ++pos;
+        if (negada) {
+            bytes.flip();
+        }
+        return true;
+    }
+};
+
+// Lee la especificacion como pares (nombre, expresion) con su numero de linea.
+struct LineaEspecificacion {
+    int numero;
+    string nombre;
+    string expresion;
+};
+
+inline bool leer_especificacion_tokens(const string& ruta, vector<LineaEspecificacion>& lineas, string& error) {
+    ifstream in(ruta);
+    if (!in.is_open()) {
+        error = "no se puede abrir '" + ruta + "'";
+        return false;
+    }
+    string linea;
+    for (int numero = 1; getline(in, linea); ++numero) {
+        size_t i = linea.find_first_not_of(" \t\r");
+        if (i == string::npos || linea[i] == '#') {
+            continue;
+        }
+        size_t j = linea.find_first_of(" \t", i);
+        size_t k = j == string::npos ? string::npos : linea.find_first_not_of(" \t", j);
+        if (k == string::npos) {
+            error = ruta + ":" + to_string(numero) + ": falta la expresion";
+            return false;
+        }
+        size_t fin = linea.find_last_not_of(" \t\r");
+        lineas.push_back({numero, linea.substr(i, j - i), linea.substr(k, fin + 1 - k)});
+    }
+    return true;
+}
+
+// Compila las reglas a un AFD por subconjuntos sobre las clases de bytes del AFN, lo
+// minimiza por refinamiento de particiones y vuelve a agrupar los bytes con la tabla final.
+inline bool construir_scanner(const vector<LineaEspecificacion>& lineas, TablasScanner& t, string& error) {
+    vector<EstadoAFN> afn(1);  // 0: inicio comun de todas las reglas
+    t.reglas.clear();
+    for (const auto& l : lineas) {
+        ReglaToken r{l.nombre, AccionRegla::TOKEN, TokenType::UNKNOWN, false};
+        if (l.nombre == "IGNORAR") {
+            r.accion = AccionRegla::IGNORAR;
+        } else if (l.nombre == "ERROR") {
+            r.accion = AccionRegla::ERROR;
+        } else {
+            bool encontrado = false;
+            for (int k = 0; k < int(TokenType::END_OF_FILE) && !encontrado; ++k) {
+                if (Token_type(TokenType(k)) == l.nombre) {
+                    r.type = TokenType(k);
+                    encontrado = true;
+                }
+            }
+            if (!encontrado) {
+                error = "linea " + to_string(l.numero) + ": token desconocido '" + l.nombre + "'";
+                return false;
+            }
+        }
+        size_t antes = afn.size();
+        int inicio, fin;
+        string error_regex;
+        if (!CompiladorRegex(l.expresion, afn).compilar(inicio, fin, error_regex)) {
+            error = "linea " + to_string(l.numero) + ": " + error_regex;
+            return false;
+        }
+        for (size_t s = antes; s < afn.size(); ++s) {
+            r.cruza_lineas = r.cruza_lineas || afn[s].bytes.test('\n');
+        }
+        afn[0].epsilon.push_back(inicio);
+        afn[fin].regla = t.reglas.size();
+        t.reglas.push_back(r);
+    }
+
+    // Clases de bytes del AFN: dos bytes quedan juntos si ningun conjunto los separa.
+    vector<int> clase_afn(256, 0);
+    int num_clases_afn = 1;
+    for (const auto& e : afn) {
+        if (e.siguiente < 0) {
+            continue;
+        }
+        map<pair<int, bool>, int> partes;
+        for (int b = 0; b < 256; ++b) {
+            partes.emplace(make_pair(clase_afn[b], bool(e.bytes.test(b))), partes.size());
+        }
+        for (int b = 0; b < 256; ++b) {
+            clase_afn[b] = partes[{clase_afn[b], bool(e.bytes.test(b))}];
+        }
+        num_clases_afn = partes.size();
+    }
+    vector<int> representante(num_clases_afn);
+    for (int b = 255; b >= 0; --b) {
+        representante[clase_afn[b]] = b;
+    }
+
+    // Subconjuntos. El conjunto vacio es el estado muerto 0.
+    auto cerrar = [&](vector<int> conjunto) {
+        vector<char> visto(afn.size(), 0);
+        for (int s : conjunto) visto[s] = 1;
+        for (size_t i = 0; i < conjunto.size(); ++i) {
+            for (int e : afn[conjunto[i]].epsilon) {
+                if (!visto[e]) {
+                    visto[e] = 1;
+                    conjunto.push_back(e);
+                }
+            }
+        }
+        sort(conjunto.begin(), conjunto.end());
+        return conjunto;
+    };
+    map<vector<int>, int> id_conjunto;
+    vector<vector<int>> conjuntos;
+    auto obtener = [&](vector<int> conjunto) {
+        auto it = id_conjunto.find(conjunto);
+        if (it != id_conjunto.end()) {
+            return it->second;
+        }
+        id_conjunto.emplace(conjunto, conjuntos.size());
+        conjuntos.push_back(move(conjunto));
+        return int(conjuntos.size()) - 1;
+    };
+    obtener({});
+    obtener(cerrar({0}));
+    vector<vector<int>> mover;
+    for (size_t d = 0; d < conjuntos.size(); ++d) {
+        mover.emplace_back(num_clases_afn);
+        for (int c = 0; c < num_clases_afn; ++c) {
+            vector<int> destino;
+            for (int s : conjuntos[d]) {
+                if (afn[s].siguiente >= 0 && afn[s].bytes.test(representante[c])) {
+                    destino.push_back(afn[s].siguiente);
+                }
+            }
+            mover[d][c] = obtener(cerrar(destino));
+        }
+    }
+    size_t num_afd = conjuntos.size();
+    vector<int> regla_afd(num_afd, -1);
+    for (size_t d = 0; d < num_afd; ++d) {
+        for (int s : conjuntos[d]) {
+            if (afn[s].regla >= 0 && (regla_afd[d] < 0 || afn[s].regla < regla_afd[d])) {
+                regla_afd[d] = afn[s].regla;
+            }
+        }
+    }
+    if (regla_afd[1] >= 0) {
+        error = "la regla " + t.reglas[regla_afd[1]].nombre + " acepta la cadena vacia";
+        return false;
+    }
+
+    // Minimizacion de Moore: se parte por regla aceptada y se refina por los bloques de
+    // los sucesores hasta que la particion no cambia.
+    vector<int> bloque(regla_afd.begin(), regla_afd.end());
+    size_t num_bloques = 0;
+    while (true) {
+        map<vector<int>, int> firmas;
+        vector<int> nuevo(num_afd);
+        for (size_t d = 0; d < num_afd; ++d) {
+            vector<int> firma = {bloque[d]};
+            for (int c = 0; c < num_clases_afn; ++c) {
+                firma.push_back(bloque[mover[d][c]]);
+            }
+            nuevo[d] = firmas.emplace(move(firma), firmas.size()).first->second;
+        }
+        bloque.swap(nuevo);
+        if (firmas.size() == num_bloques) {
+            break;
+        }
+        num_bloques = firmas.size();
+    }
+
+    // Numeracion final: muerto, inicial, el resto de los que no aceptan y luego los que
+    // aceptan, cada grupo en el orden del AFD.
+    vector<int> numero(num_bloques, -1);
+    vector<int> orden = {bloque[0], bloque[1]};
+    for (int aceptan = 0; aceptan < 2; ++aceptan) {
+        for (size_t d = 0; d < num_afd; ++d) {
+            if ((regla_afd[d] >= 0) == bool(aceptan)) {
+                orden.push_back(bloque[d]);
+            }
+        }
+    }
+    int siguiente_numero = 0;
+    for (int b : orden) {
+        if (numero[b] < 0) {
+            numero[b] = siguiente_numero++;
+            if (b == bloque[0] && b == bloque[1]) {
+                error = "ninguna regla reconoce una cadena";
+                return false;
+            }
+        }
+    }
+    t.num_estados = num_bloques;
+    t.primer_aceptador = num_bloques;
+    t.regla.assign(num_bloques, -1);
+    vector<int> ejemplo(num_bloques, -1);
+    for (size_t d = 0; d < num_afd; ++d) {
+        int e = numero[bloque[d]];
+        ejemplo[e] = d;
+        t.regla[e] = regla_afd[d];
+        if (regla_afd[d] >= 0) {
+            t.primer_aceptador = min(t.primer_aceptador, e);
+        }
+    }
+    if (size_t(t.num_estados) * num_clases_afn > 65535) {
+        error = "el automata tiene demasiados estados";
+        return false;
+    }
+
+    // Clases finales: columnas iguales de la tabla minima se unen.
+    map<vector<int>, int> columnas;
+    vector<int> clase_final(num_clases_afn);
+    for (int c = 0; c < num_clases_afn; ++c) {
+        vector<int> columna(t.num_estados);
+        for (int e = 0; e < t.num_estados; ++e) {
+            columna[e] = numero[bloque[mover[ejemplo[e]][c]]];
+        }
+        clase_final[c] = columnas.emplace(move(columna), columnas.size()).first->second;
+    }
+    t.num_clases = columnas.size();
+    for (int b = 0; b < 256; ++b) {
+        t.clase[b] = clase_final[clase_afn[b]];
+    }
+    t.transicion.assign(size_t(t.num_estados) * t.num_clases, 0);
+    for (const auto& [columna, c] : columnas) {
+        for (int e = 0; e < t.num_estados; ++e) {
+            t.transicion[e * t.num_clases + c] = columna[e];
+        }
+    }
+    return true;
+}
+
+inline bool cargar_scanner(const string& ruta, TablasScanner& t, string& error) {
+    vector<LineaEspecificacion> lineas;
+    if (!leer_especificacion_tokens(ruta, lineas, error)) {
+        return false;
+    }
+    if (!construir_scanner(lineas, t, error)) {
+        error = ruta + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+// Scanner sobre las tablas: la coincidencia mas larga se busca recorriendo la tabla hasta
+// el estado muerto y recordando el ultimo estado que acepta. Las filas se guardan ya
+// multiplicadas por el numero de clases, asi que cada caracter es una suma y una lectura.
+class ScannerDFA {
+public:
+    ostream* errores = &cerr;
+
+    explicit ScannerDFA(const TablasScanner& t) : t(t) {
+        fila.resize(t.transicion.size());
+        for (size_t i = 0; i < fila.size(); ++i) {
+            fila[i] = t.transicion[i] * t.num_clases;
+        }
+    }
+
+    bool abrir(const string& ruta) {
+        bool ok = buffer.abrir(ruta);
+        pos_fuente = inicio_linea = buffer.inicio();
+        fin_fuente = buffer.fin();
+        linea_fuente = 1;
+        return ok;
+    }
+
+    void cerrar() {
+        buffer.cerrar();
+        pos_fuente = fin_fuente = inicio_linea = nullptr;
+    }
+
+    size_t bytes() const {
+        return buffer.fin() - buffer.inicio();
+    }
+
+    TokenVista siguiente() {
+        const uint16_t* tabla = fila.data();
+        const uint8_t* clase = t.clase;
+        const uint32_t primer_aceptador = uint32_t(t.primer_aceptador) * t.num_clases;
+        while (true) {
+            const char* inicio = pos_fuente;
+            int linea = linea_fuente;
+            int columna = int(inicio - inicio_linea) + 1;
+            if (inicio == fin_fuente) {
+                return {TokenType::END_OF_FILE, {}, linea, columna};
+            }
+            uint32_t estado = t.num_clases, aceptado = 0;
+            const char* fin_token = inicio;
+            for (const char* p = inicio; p < fin_fuente;) {
+                estado = tabla[estado + clase[(unsigned char)*p++]];
+                if (estado == 0) {
+                    break;
+                }
+                if (estado >= primer_aceptador) {
+                    aceptado = estado;
+                    fin_token = p;
+                }
+            }
+            if (aceptado == 0) {
+                avanzar(inicio + 1);
+                *errores << "Error: Caracter invalido '" << *inicio << "' en línea " << linea << ", columna " << columna << endl;
+                return {TokenType::UNKNOWN, {}, linea, columna};
+            }
+            const ReglaToken& r = t.reglas[t.regla[aceptado / t.num_clases]];
+            if (r.cruza_lineas) {
+                avanzar(fin_token);
+            } else {
+                pos_fuente = fin_token;
+            }
+            string_view valor(inicio, fin_token - inicio);
+            if (r.accion == AccionRegla::TOKEN) {
+                return {r.type, valor, linea, columna};
+            }
+            if (r.accion == AccionRegla::ERROR) {
+                string_view muestra = valor.substr(0, min(valor.find('\n'), size_t(20)));
+                *errores << "Error: token invalido '" << muestra << (muestra.size() < valor.size() ? "..." : "")
+                         << "' en línea " << linea << ", columna " << columna << endl;
+                return {TokenType::UNKNOWN, valor, linea, columna};
+            }
+        }
+    }
+
+private:
+    const TablasScanner& t;
+    vector<uint16_t> fila;
+    BufferFuente buffer;
+    const char* pos_fuente = nullptr;
+    const char* fin_fuente = nullptr;
+    const char* inicio_linea = nullptr;
+    int linea_fuente = 1;
+
+    // Mueve la posicion hasta hasta contando los saltos de linea del camino.
+    void avanzar(const char* hasta) {
+        const char* ultimo = nullptr;
+        size_t n = kernels_lexicos().contar_saltos(pos_fuente, hasta, ultimo);
+        if (n) {
+            linea_fuente += n;
+            inicio_linea = ultimo + 1;
+        }
+        pos_fuente = hasta;
+    }
+};
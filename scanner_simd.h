@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCANNER_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Nucleos del scanner mapeado para las corridas largas: blancos, identificadores, digitos,
+// el '\n' que cierra un comentario de linea y el "*/" de uno de bloque. Cada uno devuelve
+// el primer byte que ya no pertenece a la corrida (o fin). Las versiones SSE2 y AVX2
+// clasifican 16 o 32 bytes por iteracion con una mascara de bits, y contar_saltos suma
+// los '\n' de un tramo con popcount. kernels_lexicos() elige la mejor version que la CPU
+// soporta la primera vez que se llama; la escalar queda para el resto de las maquinas y
+// para la cola de menos de un bloque.
+//
+// Las clases son las del locale "C" (isspace, isalnum, isdigit) pero sin ctype.
+
+inline bool es_blanco_ascii(unsigned char c) {
+    return c == ' ' || unsigned(c - '\t') <= unsigned('\r' - '\t');
+}
+
+inline bool es_digito_ascii(unsigned char c) {
+    return unsigned(c - '0') <= 9;
+}
+
+inline bool es_letra_ascii(unsigned char c) {
+    return unsigned((c | 0x20) - 'a') <= 25;
+}
+
+inline bool es_alnum_ascii(unsigned char c) {
+    return es_digito_ascii(c) || es_letra_ascii(c);
+}
+
+struct KernelsLexicos {
+    const char* nombre;
+    const char* (*fin_blancos)(const char* p, const char* fin);
+    const char* (*fin_alnum)(const char* p, const char* fin);
+    const char* (*fin_digitos)(const char* p, const char* fin);
+    const char* (*buscar_salto)(const char* p, const char* fin);
+    const char* (*buscar_cierre)(const char* p, const char* fin);  // el '*' de "*/"
+    // Cantidad de '\n' en [p, fin); ultimo queda en el ultimo de ellos si hay alguno.
+    size_t (*contar_saltos)(const char* p, const char* fin, const char*& ultimo);
+};
+
+namespace escalar {
+
+inline const char* fin_blancos(const char* p, const char* fin) {
+    while (p < fin && es_blanco_ascii(*p)) ++p;
+    return p;
+}
+
+inline const char* fin_alnum(const char* p, const char* fin) {
+    while (p < fin && es_alnum_ascii(*p)) ++p;
+    return p;
+}
+
+inline const char* fin_digitos(const char* p, const char* fin) {
+    while (p < fin && es_digito_ascii(*p)) ++p;
+    return p;
+}
+
+inline const char* buscar_salto(const char* p, const char* fin) {
+    while (p < fin && *p != '\n') ++p;
+    return p;
+}
+
+inline const char* buscar_cierre(const char* p, const char* fin) {
+    for (; p + 1 < fin; ++p) {
+        if (p[0] == '*' && p[1] == '/') return p;
+    }
+    return fin;
+}
+
+inline size_t contar_saltos(const char* p, const char* fin, const char*& ultimo) {
+    size_t n = 0;
+    for (; p < fin; ++p) {
+        if (*p == '\n') {
+            ++n;
+            ultimo = p;
+        }
+    }
+    return n;
+}
+
+}  // namespace escalar
+
+inline constexpr KernelsLexicos KERNELS_ESCALARES = {
+    "escalar",
+    escalar::fin_blancos,
+    escalar::fin_alnum,
+    escalar::fin_digitos,
+    escalar::buscar_salto,
+    escalar::buscar_cierre,
+    escalar::contar_saltos,
+};
+
+#ifdef SCANNER_SIMD_X86
+
+// Un mismo cuerpo para SSE2 y AVX2: V da el ancho del registro y las operaciones, y cada
+// nucleo construye la mascara de los bytes que cortan la corrida.
+#define SCANNER_SIMD_NUCLEOS(V, ATRIBUTO)                                                          \
+    ATRIBUTO inline uint32_t mascara_blancos(typename V::reg v) {                                 \
+        typename V::reg t = V::sumar(v, V::repetir(-'\t'));                                       \
+        typename V::reg control = V::igual(V::minimo(t, V::repetir('\r' - '\t')), t);              \
+        return V::mascara(V::o(control, V::igual(v, V::repetir(' '))));                           \
+    }                                                                                              \
+    ATRIBUTO inline uint32_t mascara_digitos(typename V::reg v) {                                 \
+        typename V::reg t = V::sumar(v, V::repetir(-'0'));                                        \
+        return V::mascara(V::igual(V::minimo(t, V::repetir(9)), t));                              \
+    }                                                                                              \
+    ATRIBUTO inline uint32_t mascara_alnum(typename V::reg v) {                                   \
+        typename V::reg l = V::sumar(V::o(v, V::repetir(0x20)), V::repetir(-'a'));                \
+        uint32_t letras = V::mascara(V::igual(V::minimo(l, V::repetir(25)), l));                 \
+        return letras | mascara_digitos(v);                                                       \
+    }                                                                                              \
+    /* Primer byte de p donde la mascara de la clase es 0; la cola va por la version escalar. */  \
+    template <uint32_t (*Mascara)(typename V::reg), const char* (*Cola)(const char*, const char*)> \
+    ATRIBUTO inline const char* fin_corrida(const char* p, const char* fin) {                     \
+        for (; fin - p >= V::ANCHO; p += V::ANCHO) {                                              \
+            uint32_t fuera = ~Mascara(V::cargar(p)) & V::TODOS;                                   \
+            if (fuera) return p + __builtin_ctz(fuera);                                           \
+        }                                                                                          \
+        return Cola(p, fin);                                                                      \
+    }                                                                                              \
+    ATRIBUTO inline const char* fin_blancos(const char* p, const char* fin) {                     \
+        return fin_corrida<mascara_blancos, escalar::fin_blancos>(p, fin);                        \
+    }                                                                                              \
+    ATRIBUTO inline const char* fin_alnum(const char* p, const char* fin) {                       \
+        return fin_corrida<mascara_alnum, escalar::fin_alnum>(p, fin);                            \
+    }                                                                                              \
+    ATRIBUTO inline const char* fin_digitos(const char* p, const char* fin) {                     \
+        return fin_corrida<mascara_digitos, escalar::fin_digitos>(p, fin);                        \
+    }                                                                                              \
+    ATRIBUTO inline const char* buscar_salto(const char* p, const char* fin) {                    \
+        for (; fin - p >= V::ANCHO; p += V::ANCHO) {                                              \
+            uint32_t m = V::mascara(V::igual(V::cargar(p), V::repetir('\n')));                   \
+            if (m) return p + __builtin_ctz(m);                                                   \
+        }                                                                                          \
+        return escalar::buscar_salto(p, fin);                                                     \
+    }                                                                                              \
+    /* Compara el bloque en p con '*' y el de p + 1 con '/': un bit comun es un cierre. */        \
+    ATRIBUTO inline const char* buscar_cierre(const char* p, const char* fin) {                   \
+        for (; fin - p > V::ANCHO; p += V::ANCHO) {                                               \
+            uint32_t m = V::mascara(V::igual(V::cargar(p), V::repetir('*'))) &                   \
+                         V::mascara(V::igual(V::cargar(p + 1), V::repetir('/')));                \
+            if (m) return p + __builtin_ctz(m);                                                   \
+        }                                                                                          \
+        return escalar::buscar_cierre(p, fin);                                                    \
+    }                                                                                              \
+    ATRIBUTO inline size_t contar_saltos(const char* p, const char* fin, const char*& ultimo) {    \
+        size_t n = 0;                                                                              \
+        for (; fin - p >= V::ANCHO; p += V::ANCHO) {                                              \
+            uint32_t m = V::mascara(V::igual(V::cargar(p), V::repetir('\n')));                   \
+            if (m) {                                                                               \
+                n += __builtin_popcount(m);                                                       \
+                ultimo = p + 31 - __builtin_clz(m);                                               \
+            }                                                                                      \
+        }                                                                                          \
+        return n + escalar::contar_saltos(p, fin, ultimo);                                        \
+    }
+
+namespace sse2 {
+
+struct V {
+    using reg = __m128i;
+    static constexpr int ANCHO = 16;
+    static constexpr uint32_t TODOS = 0xFFFF;
+    __attribute__((target("sse2"))) static reg cargar(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+    __attribute__((target("sse2"))) static reg repetir(char c) { return _mm_set1_epi8(c); }
+    __attribute__((target("sse2"))) static reg sumar(reg a, reg b) { return _mm_add_epi8(a, b); }
+    __attribute__((target("sse2"))) static reg minimo(reg a, reg b) { return _mm_min_epu8(a, b); }
+    __attribute__((target("sse2"))) static reg igual(reg a, reg b) { return _mm_cmpeq_epi8(a, b); }
+    __attribute__((target("sse2"))) static reg o(reg a, reg b) { return _mm_or_si128(a, b); }
+    __attribute__((target("sse2"))) static uint32_t mascara(reg a) { return uint32_t(_mm_movemask_epi8(a)); }
+};
+
+SCANNER_SIMD_NUCLEOS(V, __attribute__((target("sse2"))))
+
+}  // namespace sse2
+
+namespace avx2 {
+
+struct V {
+    using reg = __m256i;
+    static constexpr int ANCHO = 32;
+    static constexpr uint32_t TODOS = 0xFFFFFFFF;
+    __attribute__((target("avx2"))) static reg cargar(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    __attribute__((target("avx2"))) static reg repetir(char c) { return _mm256_set1_epi8(c); }
+    __attribute__((target("avx2"))) static reg sumar(reg a, reg b) { return _mm256_add_epi8(a, b); }
+    __attribute__((target("avx2"))) static reg minimo(reg a, reg b) { return _mm256_min_epu8(a, b); }
+    __attribute__((target("avx2"))) static reg igual(reg a, reg b) { return _mm256_cmpeq_epi8(a, b); }
+    __attribute__((target("avx2"))) static reg o(reg a, reg b) { return _mm256_or_si256(a, b); }
+    __attribute__((target("avx2"))) static uint32_t mascara(reg a) { return uint32_t(_mm256_movemask_epi8(a)); }
+};
+
+SCANNER_SIMD_NUCLEOS(V, __attribute__((target("avx2,popcnt"))))
+
+}  // namespace avx2
+
+#undef SCANNER_SIMD_NUCLEOS
+
+inline constexpr KernelsLexicos KERNELS_SSE2 = {
+    "sse2",
+    sse2::fin_blancos,
+    sse2::fin_alnum,
+    sse2::fin_digitos,
+    sse2::buscar_salto,
+    sse2::buscar_cierre,
+    sse2::contar_saltos,
+};
+
+inline constexpr KernelsLexicos KERNELS_AVX2 = {
+    "avx2",
+    avx2::fin_blancos,
+    avx2::fin_alnum,
+    avx2::fin_digitos,
+    avx2::buscar_salto,
+    avx2::buscar_cierre,
+    avx2::contar_saltos,
+};
+
+#endif
+
+// Las versiones que esta CPU puede ejecutar, de la mas ancha a la escalar.
+inline vector<const KernelsLexicos*> kernels_disponibles() {
+    vector<const KernelsLexicos*> disponibles;
+#ifdef SCANNER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        disponibles.push_back(&KERNELS_AVX2);
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        disponibles.push_back(&KERNELS_SSE2);
+    }
+#endif
+    disponibles.push_back(&KERNELS_ESCALARES);
+    return disponibles;
+}
+
+inline const KernelsLexicos& kernels_lexicos() {
+    static const KernelsLexicos* elegidos = kernels_disponibles().front();
+    return *elegidos;
+}